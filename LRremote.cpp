@@ -9,6 +9,8 @@
  *
  * Normal use consists of instantiating a LRremote object in the static part of the sketch, invoking enable() in the 
  * sketch's setup() function and then invoking onButton() in the sketch's loop() function to get input from the IR remote.
+ * If the receiver is on a pin with an external interrupt (pins 2 and 3 on an Uno), enable(CAPTURE_EDGE) records the
+ * transmission from pin change interrupts instead of polling the receiver 20,000 times a second.
  *
  *****/
 
@@ -22,118 +24,1174 @@
  *
  * ISR state data
  *
+ * Each LRremote has its own capture state, an LRcapture (see LRremote.h), and the ISRs work on whichever one they're
+ * given. enable() adds it to polled[], the receivers the timer ISR samples on every tick, or, for CAPTURE_EDGE, to
+ * edged[], where the edge ISR trampoline attached to the receiver's pin finds it.
+ *
+ * The ISR records each receiver's transmissions into a ring of RAWFRAMES frame slots. frameHead counts the frames it 
+ * has finished and frameTail counts the ones the application has finished with, so frameHead - frameTail frames are
+ * waiting to be decoded. The ISR only ever writes to slot frameHead % RAWFRAMES, through capbuf, and only while that 
+ * slot is free. When every slot is full it parks in STATE_STOP and counts the transmissions it misses in 
+ * overrunCount.
+ *
+ * service() decodes the waiting frames, releases their slots and queues the results in the receiver's events[] for 
+ * read(). With ISR_BOTTOM_HALF, the ISR that finishes a frame calls it for every receiver in receivers[] (see 
+ * bottomHalf()); otherwise read() does. servicing makes sure only one service() runs at a time, so each receiver's 
+ * events[] has just the one producer and the one consumer.
+ *
+ */
+static LRcapture *polled[MAX_RECEIVERS];				// Receivers using CAPTURE_POLL
+static volatile uint8_t polledCount;					// Count of entries in polled[]
+static LRcapture *edged[MAX_RECEIVERS];					// Receivers using CAPTURE_EDGE, by trampoline
+#ifdef LR_PORT_SAMPLING
+static volatile uint8_t *ports[MAX_RECEIVERS];			// The port input registers of the polled receivers
+static volatile uint8_t portCount;						// Count of entries in ports[]
+#endif
+static LRreceiver *receivers[MAX_RECEIVERS];			// Every enabled receiver
+static volatile uint8_t receiverCount;					// Count of entries in receivers[]
+static volatile bool servicing;							// A service() is running
+#ifdef ISR_BOTTOM_HALF
+static volatile bool framesDone;						// Frames have been finished since the last bottom half
+#endif
+#ifdef LATENCY_STATS
+static LRlatency latencyStats;							// Latency histograms, for every receiver
+#endif
+#ifdef DECODE_STATS
+static LRstats lrStats;									// Statistics counters (LR_STAT()), for every receiver
+#endif
+#ifdef IR_SEND
+static volatile bool sendBusy;							// LRsender has a frame going out on the timer
+#endif
+
+#ifdef STREAM_DECODE
+static void streamEntry(LRcapture &c, unsigned int ix, unsigned int ticks);
+static int8_t streamWinner(LRcapture &c, bool ended);
+static void streamResult(LRcapture &c, volatile DecodeResult &result, int8_t winner);
+#endif
+
+#if (RAWFRAMES & (RAWFRAMES - 1)) != 0
+#error "RAWFRAMES must be a power of two"
+#endif
+#if (EVENT_QUEUE & (EVENT_QUEUE - 1)) != 0
+#error "EVENT_QUEUE must be a power of two"
+#endif
+
+/*
+ * frameSlot() -- Return the address of c's frame slot for frame number slot (frameHead or frameTail).
+ *
+ * The slots' size and their entries' are set by the LRremoteBuf the LRcapture belongs to, so framebuf is just bytes.
+ * rawEntry() reads entry ix of one of them.
+ *
+ */
+static inline volatile uint8_t *frameSlot(LRcapture &c, uint8_t slot) {
+	return c.framebuf + (slot % RAWFRAMES) * c.frameCap * c.rawSize;
+}
+
+static inline unsigned int rawEntry(LRcapture &c, volatile uint8_t *buf, unsigned int ix) {
+	return c.rawSize == 1 ? buf[ix] : ((volatile uint16_t *)buf)[ix];
+}
+
+/*
+ * frameDone() -- Finish recording the transmission in capbuf.
+ *
+ * Hands the slot over to the decoding side and moves on to the next one. If there isn't a free one, the ISR goes to
+ * STATE_STOP until resume() releases a slot. Only called from the ISRs or with interrupts disabled.
+ *
+ */
+static void frameDone(LRcapture &c) {
+#ifdef STREAM_DECODE
+	streamResult(c, c.frameResult[c.frameHead % RAWFRAMES], streamWinner(c, true));
+#endif
+	LR_STAT(frames);
+	c.framelen[c.frameHead % RAWFRAMES] = c.caplen;
+	c.frameTime[c.frameHead % RAWFRAMES] = micros();
+	c.frameHead++;
+#ifdef ISR_BOTTOM_HALF
+	framesDone = true;
+#endif
+	c.caplen = 0;
+	if ((uint8_t)(c.frameHead - c.frameTail) >= RAWFRAMES) {	// If every slot is now waiting to be decoded
+		c.rcvstate = STATE_STOP;							//   Nowhere to record. Wait for resume().
+	} else {
+		c.capbuf = frameSlot(c, c.frameHead);				// Else start looking for the next transmission
+		c.rcvstate = STATE_IDLE;
+	}
+}
+
+#ifdef ISR_BOTTOM_HALF
+/*
+ * bottomHalf() -- Decode the frames the ISR just finished. Called at the end of the ISRs, with interrupts disabled.
+ *
+ * Decoding a frame can take several hundred microseconds, several ticks, which is far too long to keep interrupts
+ * disabled. So once the ISR's own work is done, it enables them again and services the receivers from here. Ticks 
+ * that arrive meanwhile interrupt the bottom half as they would anything else; servicing keeps them from starting 
+ * another one. Since interrupts are disabled until the sei(), testing servicing needs no more protection than that.
+ *
+ */
+static void bottomHalf() {
+	if (!framesDone || servicing) {
+		return;
+	}
+	framesDone = false;
+	sei();
+	for (uint8_t i = 0; i < receiverCount; i++) {
+		receivers[i]->service();
+	}
+	cli();
+}
+#endif
+
+/*
+ * record() -- Record the duration of the MARK or SPACE that just ended in capbuf.
+ *
+ * A duration too long for an entry of capbuf is stored as rawLong, an escape. Within a transmission that's longer 
+ * than anything any decoder looks for, so rawLong is all they need to know. The gap before it is the one duration 
+ * that's routinely that long and whose length matters (Sony and Sanyo tell a fast repeat by it), so the gap's real 
+ * length goes in framegap[] for the slot, where gapTicks() finds it.
+ *
+ * With STREAM_DECODE, it's also fed to the streaming decoders, which may decide that was the end of the frame and
+ * call frameDone(). So callers set rcvstate for the next entry before recording this one.
+ *
+ */
+static inline void record(LRcapture &c, unsigned int ticks) {
+	LR_COUNT(records);
+	unsigned int ix = c.caplen++;
+#ifdef CALIBRATE_EXCESS
+	if (ix != 0) {											// Correct for the receiver's MARK excess
+		int corrected = (ix & 1) ? (int)ticks - c.markTicks : (int)ticks + c.markTicks;
+		ticks = corrected > 0 ? corrected : 1;
+	}
+#endif
+	unsigned int entry = ticks;
+	if (ticks >= c.rawLong) {								// Too long to store
+		entry = c.rawLong;									//   Escape it
+		if (ix == 0) {										//   and, if it's the gap, keep its length
+			c.framegap[c.frameHead % RAWFRAMES] = ticks;
+		}
+	}
+#ifdef LATENCY_STATS
+	if (ix == 0) {											// The gap just ended: the frame starts now
+		c.frameStart[c.frameHead % RAWFRAMES] = micros();
+	}
+#endif
+	if (c.rawSize == 1) {
+		c.capbuf[ix] = entry;
+	} else {
+		((volatile uint16_t *)c.capbuf)[ix] = entry;
+	}
+#ifdef STREAM_DECODE
+	streamEntry(c, ix, ticks);
+#endif
+}
+
+/*
+ * Edge interrupt service routine to collect raw data (CAPTURE_EDGE).
+ *
+ * Invoked on every change of the IR receiver output. The time since the previous change, measured with the
+ * free-running micros() clock and rounded to 50us ticks, is the duration of the MARK or SPACE that just ended. It
+ * goes into capbuf[] exactly where the timer ISR below would have put it, so the decoders can't tell which engine
+ * did the recording. 
+ *
+ * Since nothing runs between edges, the final long SPACE that ends a transmission is noticed by decode() instead,
+ * using frameEnded(). If another MARK shows up before anyone has looked, the SPACE state notices the gap here.
+ *
+ * attachInterrupt() handlers get no arguments, so each receiver's interrupt is attached to the trampoline for its 
+ * slot in edged[], which passes edgeISR() the right LRcapture.
+ *
+ */
+static void edgeISR(LRcapture &c) {
+	LR_COUNT(edges);
+	unsigned long now = micros();
+#ifdef LR_PORT_SAMPLING
+	LR_COUNT(portReads);
+	uint8_t irdata = (*c.pinReg & c.pinMask) ? SPACE : MARK;	// Level the receiver just changed to
+#else
+	uint8_t irdata = (uint8_t)digitalRead(c.recvpin);		// Level the receiver just changed to
+#endif
+	unsigned long elapsed = now - c.lastEdge;
+#ifdef CALIBRATE_EXCESS
+	// Correct for the receiver's MARK excess: the part record() can't, in whole ticks (see measureExcess())
+	if (c.rcvstate == STATE_MARK && (long)elapsed > c.markUs) {
+		elapsed -= c.markUs;
+	} else if (c.rcvstate == STATE_SPACE && (long)elapsed > -c.markUs) {
+		elapsed += c.markUs;
+	}
+#endif
+	unsigned int ticks = elapsed >= GAP_MAX_TICKS * USECPERTICK ? GAP_MAX_TICKS : USEC_TO_TICKS(elapsed);
+
+	switch(c.rcvstate) {
+		case STATE_MARK:									// We're timing a MARK
+			if (irdata != SPACE) {							//  If we somehow missed the end of it
+				return;										//    Let the MARK run on; keep its start time
+			}
+			c.rcvstate = STATE_SPACE;						//  Start timing the SPACE that follows
+			record(c, ticks);								//  and record the duration
+			break;
+		case STATE_SPACE:									// We're timing a SPACE
+			if (irdata != MARK) {
+				return;
+			}
+			if (ticks < GAP_TICKS) {						//  If it's just a SPACE within the transmission
+				c.rcvstate = STATE_MARK;					//    Start timing the MARK that follows
+				record(c, ticks);							//    and record the duration
+				break;
+			}
+			frameDone(c);									//  Else it ended the transmission and nobody noticed
+			if (c.rcvstate == STATE_STOP) {					//    If there's no room for the one just starting
+				c.overrunCount++;							//      It's lost
+				LR_STAT(overruns);
+				break;
+			}
+			// Fall through: the MARK that just started begins the next transmission
+		case STATE_IDLE:									// We're idling, supposedly in the middle of a gap
+			if (irdata == MARK) {							//   If it looks like that just ended
+				if (ticks >= GAP_TICKS) {					//     And it was big enough to be real
+					c.rcvstate = STATE_MARK;				//       Start recording the transmission
+					c.caplen = 0;							//       with the gap
+					record(c, ticks);
+				}
+			}
+			break;
+		case STATE_STOP:									// Every slot is full
+			if (irdata == MARK && ticks >= GAP_TICKS) {		//   If a transmission is starting
+				c.overrunCount++;							//     It's lost
+				LR_STAT(overruns);
+			}
+			break;
+	}
+	if (c.caplen >= c.frameCap) {							// If the buffer is full to capacity
+		LR_STAT(truncated);
+		frameDone(c);										//  We had a transmission error. Stop recording it.
+	}
+	c.lastEdge = now;
+#ifdef ISR_BOTTOM_HALF
+	bottomHalf();
+#endif
+}
+
+#if MAX_RECEIVERS > 4
+#error "Add edge ISR trampolines for the extra receivers"
+#endif
+static void edgeISR0() { edgeISR(*edged[0]); }
+static void edgeISR1() { edgeISR(*edged[1]); }
+static void edgeISR2() { edgeISR(*edged[2]); }
+static void edgeISR3() { edgeISR(*edged[3]); }
+static void (*const edgeTrampoline[4])() = {edgeISR0, edgeISR1, edgeISR2, edgeISR3};
+
+/*
+ * frameEnded() -- Notice the end of a transmission when using CAPTURE_EDGE.
+ *
+ * With no timer ticking, the long SPACE at the end of a transmission has no edge to report it. Instead, whoever
+ * wants the data asks here whether the receiver has been quiet for more than a gap since the last MARK ended.
+ *
+ */
+static void frameEnded(LRcapture &c) {
+	cli();
+	if (c.rcvstate == STATE_SPACE && micros() - c.lastEdge >= _GAP) {
+		frameDone(c);
+	}
+	sei();
+}
+
+/*
+ * Constructor for LRremote object
+ *
+ * rpin is the pin to which the IR receiver is attached. Each LRremote has its own receiver and capture state, so 
+ * a sketch can have up to MAX_RECEIVERS of them, each on its own pin.
+ *
+ * The frame slots are the LRremoteBuf's: buffer holds RAWFRAMES of them, each capacity entries of rawSize bytes.
+ *
+ */
+LRreceiver::LRreceiver(int rpin, volatile void *buffer, unsigned int capacity, uint8_t rawSize) {
+	cap.recvpin = rpin;					// Remember which pin the IR receiver is on
+	cap.framebuf = (volatile uint8_t *)buffer;
+	cap.frameCap = capacity;
+	cap.rawSize = rawSize;
+	cap.rawLong = rawSize == 1 ? 0xFF : 0xFFFF;
+  
+	lastValue = 0;						// Init REPEAT processing
+	lastIx = 0;
+	holding = false;
+	setRepeat(REPEAT_DELAY, REPEAT_RATE);
+	cap.rcvstate = STATE_IDLE;			// Initialize state machine variables
+	cap.frameHead = cap.frameTail = 0;
+	cap.capbuf = cap.framebuf;
+	cap.caplen = 0;
+	cap.overrunCount = 0;
+#ifdef VALIDATE_FRAMES
+	cap.address = -1;
+#endif
+	eventHead = eventTail = 0;
+#if LR_DECODES(LEARNED)
+	learnInto = 0;
+	templates = 0;
+	templateCount = 0;
+#endif
+	eventDrops = 0;
+#ifdef CALIBRATE_EXCESS
+	calibrating = false;
+	memset(&calibration, 0, sizeof(calibration));
+	calibration.excess = MARK_EXCESS;	// Nothing to correct. Not setMarkExcess(): no cli()/sei() before init()
+	cap.markTicks = 0;
+	cap.markUs = 0;
+#endif
+	pinMode(cap.recvpin, INPUT);		// Set pin mode so we can read the IR receiver
+
+}
+
+/*
+ * enable() -- Enable capture interrupts.
+ *
+ * Needs to be a separate method invoked during setup(). Can't do it in the constructor because the Arduino
+ * environment messes with the timer during reset.
+ *
+ * mode selects the capture engine. CAPTURE_POLL (the default) samples the receiver from the 50us timer interrupt.
+ * CAPTURE_EDGE takes an external interrupt on each transition instead, so nothing runs while the air is quiet. If
+ * the receiver pin has no external interrupt, CAPTURE_EDGE quietly falls back to CAPTURE_POLL.
+ *
+ * All the CAPTURE_POLL receivers share the one timer interrupt. Returns false, having enabled nothing, if 
+ * MAX_RECEIVERS receivers are already enabled. Enabling a receiver a second time does nothing.
+ *
+ */
+
+bool LRreceiver::enable(int mode) {
+	uint8_t enabled = polledCount;		// Receivers enabled so far
+	uint8_t slot = MAX_RECEIVERS;		// First free edge ISR trampoline
+	for (uint8_t i = 0; i < MAX_RECEIVERS; i++) {
+		if (edged[i] == &cap || (i < polledCount && polled[i] == &cap)) {
+			return true;				// Already enabled
+		}
+		if (edged[i] != 0) {
+			enabled++;
+		} else if (slot == MAX_RECEIVERS) {
+			slot = i;
+		}
+	}
+	if (enabled >= MAX_RECEIVERS) {
+		return false;
+	}
+	receivers[receiverCount] = this;	// Service this receiver along with the rest
+	receiverCount++;
+	cap.captureMode = CAPTURE_POLL;
+#ifdef LR_PORT_SAMPLING
+	cap.pinReg = portInputRegister(digitalPinToPort(cap.recvpin));	// Where the ISRs will find the receiver's level
+	cap.pinMask = digitalPinToBitMask(cap.recvpin);
+#endif
+#ifdef digitalPinToInterrupt
+	if (mode == CAPTURE_EDGE && digitalPinToInterrupt(cap.recvpin) != NOT_AN_INTERRUPT) {
+		cap.captureMode = CAPTURE_EDGE;
+		cap.lastEdge = micros();		// Whatever came before counts as gap
+		edged[slot] = &cap;
+		attachInterrupt(digitalPinToInterrupt(cap.recvpin), edgeTrampoline[slot], CHANGE);
+		return true;
+	}
+#endif
+	cli();								// Disable interrupts
+#ifdef LR_PORT_SAMPLING
+	for (cap.portIx = 0; cap.portIx < portCount && ports[cap.portIx] != cap.pinReg; cap.portIx++) {
+	}
+	if (cap.portIx == portCount) {		// Read the receiver's port on every tick
+		ports[portCount++] = cap.pinReg;
+	}
+#endif
+	polled[polledCount++] = &cap;		// Sample this receiver on every tick
+#ifdef IR_SEND
+	if (sendBusy) {						// LRsender has the timer. It sets it back when it's done.
+		sei();
+		return true;
+	}
+#endif
+	TIMER_CONFIG_NORMAL();				// Set clock interrupt interval to 50ms
+	TIMER_ENABLE_INTR;					// Enable clock interrupt
+	TIMER_RESET;						// Reset timer
+	sei();								// Enable interrupts
+	return true;
+}
+
+#ifdef IR_SEND
+/*
+ *
+ * Sending
+ *
+ * send() points the timer at the carrier frequency with TIMER_CONFIG_KHZ, leaving its interrupt on, so the ISR runs 
+ * TIMER_KHZ_INTRS times each carrier cycle instead of every 50us. While sendBusy, that's all the ISR does: sendStep()
+ * counts the interrupts down and, at the end of each MARK or SPACE, connects the timer's PWM output to the LED pin 
+ * (TIMER_ENABLE_PWM) or disconnects it (TIMER_DISABLE_PWM). The hardware makes the carrier, so nothing waits in a 
+ * delay loop and interrupts are never held off for more than one short ISR. After the last entry the timer goes back
+ * to ticking every 50us for the CAPTURE_POLL receivers, which pick up where they left off.
+ *
+ * An entry's length in interrupts is its length in us times sendScale, the interrupts per us in 16.16 fixed point, so
+ * the ISR gets by with a multiply where a divide would take longer than a carrier cycle.
+ *
+ */
+static const unsigned int *sendFrame;					// The frame going out (us); 0 for sendNEC()'s
+static unsigned long sendData;							// sendNEC()'s data
+static unsigned int sendCount;							// Count of entries in the frame
+static unsigned int sendIx;								// The next entry to start
+static unsigned int sendLeft;							// Interrupts until it starts
+static uint16_t sendScale;								// Interrupts per us, times 65536
+
+/*
+ * sendDuration() -- The length of entry ix of the frame going out, in us. sendNEC()'s frames are made up as they go.
+ *
+ */
+static unsigned int sendDuration(unsigned int ix) {
+	if (sendFrame) {
+		return sendFrame[ix];
+	}
+	if (ix == 0) {
+		return NEC_HDR_MARK;
+	}
+	if (ix == 1) {
+		return sendCount == 3 ? NEC_RPT_SPACE : NEC_HDR_SPACE;
+	}
+	if (!(ix & 1)) {
+		return NEC_BIT_MARK;
+	}
+	return (sendData & (0x80000000UL >> ((ix - 3) / 2))) ? NEC_ONE_SPACE : NEC_ZERO_SPACE;
+}
+
+/*
+ * sendStep() -- The sending ISR: count down the current entry and start the next when it's done.
+ *
+ */
+static inline void sendStep() {
+	if (--sendLeft != 0) {
+		return;
+	}
+	if (sendIx == sendCount) {								// Frame done
+		TIMER_DISABLE_PWM;
+		sendBusy = false;
+		if (polledCount != 0) {								//   Back to sampling the receivers
+			TIMER_CONFIG_NORMAL();
+		} else {
+			TIMER_DISABLE_INTR;
+		}
+		return;
+	}
+	if (sendIx & 1) {										// Entries alternate MARK, SPACE, ...
+		TIMER_DISABLE_PWM;
+	} else {
+		TIMER_ENABLE_PWM;
+	}
+	sendLeft = ((unsigned long)sendDuration(sendIx++) * sendScale + 0x8000) >> 16;
+	if (sendLeft == 0) {
+		sendLeft = 1;
+	}
+}
+
+/*
+ * send() -- Start sending count durations (us), alternating MARK, SPACE, ..., starting with a MARK, on a khz carrier.
+ *
+ * Returns at once: false, having done nothing, if a frame is still going out. durations[] is read as the frame goes
+ * out, so it has to stay put until sending() returns false. A frame with an even count ends with a SPACE, which is 
+ * sent too -- a way to keep back-to-back frames apart.
+ *
+ */
+bool LRsender::send(const unsigned int durations[], unsigned int count, uint8_t khz) {
+	if (sendBusy || count == 0) {
+		return false;
+	}
+	sendFrame = durations;
+	sendCount = count;
+	pinMode(TIMER_PWM_PIN, OUTPUT);
+	digitalWrite(TIMER_PWM_PIN, LOW);						// The LED is off when the PWM output isn't connected
+	cli();
+	sendScale = (uint16_t)(((unsigned long)khz * TIMER_KHZ_INTRS * 65536UL + 500) / 1000);
+	sendIx = 0;
+	sendLeft = 1;											// The first MARK starts on the next interrupt
+	sendBusy = true;
+	TIMER_CONFIG_KHZ(khz);
+	TIMER_ENABLE_INTR;
+	sei();
+	return true;
+}
+
+/*
+ * sendNEC() -- Start sending an NEC frame of data, 32 bits, most significant first; or, for data REPEAT, the NEC 
+ * repeat frame. Returns false if a frame is still going out.
+ *
+ */
+bool LRsender::sendNEC(unsigned long data) {
+	if (sendBusy) {
+		return false;
+	}
+	sendData = data;
+	return send(0, data == REPEAT ? 3 : 2 + 2 * NEC_BITS + 1, 38);
+}
+
+/*
+ * sending() -- Is a frame still going out?
+ *
+ */
+bool LRsender::sending() {
+	return sendBusy;
+}
+#endif
+
+/*
+ * Timer interrupt service routine (ISR) to collect raw data (CAPTURE_POLL).
+ *
+ * Durations, measured in 50 microsecond ticks, of alternating SPACE, MARK are recorded in capbuf[].
+ * The count of entries recorded so far is in caplen. The first entry is the long SPACE between transmissions.
+ *
+ * The ISR is a state machine driven by data received through the IR receiver. It starts in STATE_IDLE. At
+ * each clock tick, the state of the IR receiver is sampled and, based on the current state of the state 
+ * machine and the IR receiver state, duration of each MARK and SPACE in the sequence is recorded. Normally,
+ * a sequence ends with a long SPACE. It can also end -- abnormally -- by filling up the buffer. In either case
+ * when the sequence ends, frameDone() hands the slot over for decoding and recording carries on in the next
+ * slot. Only if every slot is waiting to be decoded does the machine stay in STATE_STOP until 
+ * LRreceiver::resume() frees one.
+ *
+ * With STREAM_DECODE, a sequence can also end as soon as the streaming decoders have all of it; see record().
+ *
+ * The one timer interrupt serves every CAPTURE_POLL receiver: sample() runs the state machine for one of them.
+ * Rather than digitalRead() each receiver's pin -- a trip through the pin tables in flash on every call -- the ISR 
+ * reads the port input registers enable() looked up, each once, and picks out the receivers' bits with their masks.
+ *
+ */
+static inline void sample(LRcapture &c, uint8_t irdata) {
+	LR_COUNT(samples);
+	c.timer++;												// Count one more 50us tick.
+	if (c.caplen >= c.frameCap) {							// If the buffer is full to capacity
+		LR_STAT(truncated);
+		frameDone(c);										//  We had a transmission error. Stop recording it.
+	}
+	switch(c.rcvstate) {
+		case STATE_IDLE:									// We're idling, supposedly in the middle of a gap
+			if (irdata == MARK) {							//   If it looks like that just ended
+				if (c.timer < GAP_TICKS) {					//     Make sure it's big enough to be real.
+					c.timer = 0;							//     If not ignore it.
+				} else {									//     Else gap just ended
+					c.rcvstate = STATE_MARK;				//       Start recording transmission with its duration
+					c.caplen = 0;
+					record(c, c.timer);
+					c.timer = 0;
+				}
+			} else if (c.timer > GAP_MAX_TICKS) {			//   Else the gap continues
+				c.timer = GAP_MAX_TICKS;					//     Past GAP_MAX_TICKS it's just long. Don't overflow.
+			}
+			break;
+		case STATE_MARK:									// We're timing a MARK
+			if (irdata == SPACE) {  						//  If the MARK ended
+				c.rcvstate = STATE_SPACE;					//    Start recording the SPACE that follows
+				record(c, c.timer);							//    and record the duration
+				c.timer = 0;
+			}
+			break;
+		case STATE_SPACE:									// We're timing a SPACE
+			if (irdata == MARK) {							// If the SPACE just ended
+				c.rcvstate = STATE_MARK;					//   Start recording the MARK that follows
+				record(c, c.timer);							//   and record the duration
+				c.timer = 0;
+			} else {										// Else the SPACE continues
+				if (c.timer >= GAP_TICKS) {					//   If it's a long space
+					frameDone(c);							//   We're done recording the sequence. Queue it 
+				}											//     for decoding.
+			}
+			break;
+		case STATE_STOP:									// Every slot is waiting to be decoded
+			if (irdata == MARK) {							//   Keep timing gaps so we can count what we miss
+				if (c.timer >= GAP_TICKS) {
+					c.overrunCount++;
+					LR_STAT(overruns);
+				}
+				c.timer = 0;
+			} else if (c.timer > GAP_TICKS) {
+				c.timer = GAP_TICKS;
+			}
+			break;
+	}
+}
+
+ISR(TIMER_INTR_NAME) {
+	TIMER_RESET;
+#ifdef IR_SEND
+	if (sendBusy) {											// Sending: the timer is running at the carrier
+		sendStep();
+		return;
+	}
+#endif
+	LR_COUNT(ticks);
+
+#ifdef LR_PORT_SAMPLING
+	uint8_t level[MAX_RECEIVERS];
+	for (uint8_t i = 0; i < portCount; i++) {				// Read each port the receivers are on just once
+		LR_COUNT(portReads);
+		level[i] = *ports[i];
+	}
+	for (uint8_t i = 0; i < polledCount; i++) {				// Sample the state of each IR receiver
+		LRcapture &c = *polled[i];
+		sample(c, (level[c.portIx] & c.pinMask) ? SPACE : MARK);
+	}
+#else
+	for (uint8_t i = 0; i < polledCount; i++) {
+		LRcapture &c = *polled[i];
+		sample(c, (uint8_t)digitalRead(c.recvpin));			// Sample the state of each IR receiver
+	}
+#endif
+#ifdef ISR_BOTTOM_HALF
+	bottomHalf();
+#endif
+}
+
+/*
+ *
+ * Resume recording transmissions.
+ *
+ * Release the frame slot that was just decoded. If the ISR state machine was stopped for lack of a free
+ * slot, restart it: STATE_STOP -> STATE_IDLE
+ *
+ */
+
+void LRreceiver::resume() {
+	cli();
+	cap.frameTail++;										// Done with this slot
+	if (cap.rcvstate == STATE_STOP) {						// If the ISR was waiting for it
+		cap.capbuf = frameSlot(cap, cap.frameHead);			//   Record into it from the start
+		cap.caplen = 0;
+		cap.rcvstate = STATE_IDLE;							//   ISR state machine starts in idle state
+	}
+	sei();
+}
+
+/*
+ * overruns() -- Return the number of transmissions missed because every frame slot, or the event queue, was full.
+ *
+ */
+unsigned int LRreceiver::overruns() {
+	cli();
+	unsigned int answer = cap.overrunCount + eventDrops;
+	sei();
+	return answer;
+}
+
+#ifdef DECODE_STATS
+/*
+ * getStats() -- Copy the statistics counters, for every receiver, into stats, clearing them if reset is true.
+ *
+ * The ISRs count frames, truncated frames and overruns; service() counts the rest, decoded[] for every transmission
+ * it decodes and rejected[] for every decoder decodeFrame() tries that doesn't match. (The streaming decoders run on
+ * every frame as it arrives and aren't counted in rejected[].) Reading and resetting them every so often, e.g. to 
+ * Serial, shows where frames are being lost and which decoders earn their keep.
+ *
+ */
+void LRreceiver::getStats(LRstats &stats, bool reset) {
+	cli();
+	stats = lrStats;
+	if (reset) {
+		memset(&lrStats, 0, sizeof(lrStats));
+	}
+	sei();
+}
+#endif
+
+#ifdef CALIBRATE_EXCESS
+/*
+ *
+ * MARK excess calibration
+ *
+ * An IR receiver module holds its output low a little after the carrier stops, so MARKs come out longer than they
+ * were sent and SPACEs shorter by the same amount. The decoders allow MARK_EXCESS for that, but modules differ, from
+ * 40us to 180us or so, and enough of a difference pushes the shorter durations out of TOLERANCE. 
+ *
+ * While calibrating, each frame a decoder in excessUnit[] recognizes is measured against the protocol's unit, the 
+ * short MARK and SPACE most of its entries are made of: how much longer than the unit each MARK of about that length 
+ * was goes in calibration.marks[], how much shorter each such SPACE was in calibration.spaces[]. Averaging the two 
+ * cancels out a remote whose clock runs fast or slow, which stretches both. Once each histogram has 
+ * CALIBRATE_SAMPLES, the average becomes the receiver's excess, and the ISRs take the difference from MARK_EXCESS off
+ * every MARK they record, and add it to every SPACE, so the decoders see durations as if the module were typical. 
+ * record() can only correct in whole ticks; the edge ISR also corrects the remainder, markUs, before rounding.
+ *
+ * The histograms are of uncorrected durations, so a correction doesn't feed back into what's measured. Each halves
+ * when it reaches CALIBRATE_WINDOW, so the estimate follows a module whose excess changes with the signal strength.
+ *
+ */
+static const struct {
+	int8_t type;
+	unsigned int mark;
+	unsigned int space;
+} excessUnit[] = {
+	{NEC,		NEC_BIT_MARK,		NEC_ZERO_SPACE},
+	{SONY,		SONY_ZERO_MARK,		SONY_HDR_SPACE},		// Sony's SPACEs are all 600us
+	{RC5,		RC5_T1,				RC5_T1},
+	{RC6,		RC6_T1,				RC6_T1},
+	{PANASONIC,	PANASONIC_BIT_MARK,	PANASONIC_ZERO_SPACE},
+	{JVC,		JVC_BIT_MARK,		JVC_ZERO_SPACE},
+	{LG,		LG_BIT_MARK,		LG_ZERO_SPACE},
+	{SAMSUNG,	SAMSUNG_BIT_MARK,	SAMSUNG_ZERO_SPACE},
+};
+
+/*
+ * addExcess() -- Count one sample of excess (us) in histogram, halving it first if it's full.
+ *
+ */
+static void addExcess(uint16_t histogram[], int excess) {
+	unsigned int total = 0;
+	for (uint8_t i = 0; i < CALIBRATE_BUCKETS; i++) {
+		total += histogram[i];
+	}
+	if (total >= CALIBRATE_WINDOW) {
+		for (uint8_t i = 0; i < CALIBRATE_BUCKETS; i++) {
+			histogram[i] /= 2;
+		}
+	}
+	int bucket = excess < CALIBRATE_MIN ? 0 : (excess - CALIBRATE_MIN) / CALIBRATE_STEP;
+	histogram[bucket < CALIBRATE_BUCKETS ? bucket : CALIBRATE_BUCKETS - 1]++;
+}
+
+/*
+ * meanExcess() -- The average of the samples in histogram, taking each as the middle of its bucket (us), and their 
+ * count.
+ *
+ */
+static int meanExcess(const uint16_t histogram[], unsigned int &count) {
+	long sum = 0;
+	count = 0;
+	for (uint8_t i = 0; i < CALIBRATE_BUCKETS; i++) {
+		sum += (long)histogram[i] * (CALIBRATE_MIN + i * CALIBRATE_STEP + CALIBRATE_STEP / 2);
+		count += histogram[i];
+	}
+	return count == 0 ? 0 : sum / (long)count;
+}
+
+/*
+ * measureExcess() -- Add the MARKs and SPACEs of the frame in rawbuf, which just decoded as decode_type, to 
+ * calibration and update the receiver's excess from it.
+ *
+ * An entry counts if it's within half a unit of the unit, allowing for MARK_EXCESS; the longer ones are other symbols
+ * or headers. Entries in rawbuf have already been corrected, so what the ISR took off them is added back: markTicks,
+ * and markUs too if it was the edge ISR. Adding back the whole (excess - MARK_EXCESS) would pull a polled receiver's
+ * estimate towards the nearest tick instead of the module's figure.
+ *
+ */
+void LRreceiver::measureExcess() {
+	uint8_t u = 0;
+	while (excessUnit[u].type != decode_type) {
+		if (++u == sizeof(excessUnit) / sizeof(excessUnit[0])) {
+			return;											// Not a protocol with a unit to measure
+		}
+	}
+	int corrected = cap.markTicks * USECPERTICK;
+	if (cap.captureMode == CAPTURE_EDGE) {
+		corrected += cap.markUs;
+	}
+	for (unsigned int ix = 1; ix < rawlen; ix++) {
+		bool isMark = ix & 1;
+		int unit = isMark ? excessUnit[u].mark : excessUnit[u].space;
+		int us = rawTicks(ix) * USECPERTICK;
+		int expected = isMark ? unit + MARK_EXCESS : unit - MARK_EXCESS;
+		if (us < expected - unit / 2 || us > expected + unit / 2) {
+			continue;
+		}
+		if (isMark) {
+			addExcess(calibration.marks, us + corrected - unit);
+		} else {
+			addExcess(calibration.spaces, unit - (us - corrected));
+		}
+	}
+	unsigned int marks, spaces;
+	int markExcess = meanExcess(calibration.marks, marks);
+	int spaceExcess = meanExcess(calibration.spaces, spaces);
+	if (marks >= CALIBRATE_SAMPLES && spaces >= CALIBRATE_SAMPLES) {
+		setMarkExcess((markExcess + spaceExcess) / 2);
+	}
+}
+
+/*
+ * calibrate() -- Start (or, for false, stop) measuring the receiver's MARK excess from the frames it decodes and 
+ * correcting for it. Stopping keeps the correction as it is. 
+ *
+ */
+void LRreceiver::calibrate(bool on) {
+	calibrating = on;
+}
+
+/*
+ * markExcess() -- The MARK excess (us) the receiver corrects for: MARK_EXCESS until calibrate() has measured it or 
+ * setMarkExcess() has set it. Worth saving, e.g. in EEPROM, for setMarkExcess() to restore at the next reset.
+ *
+ */
+int LRreceiver::markExcess() {
+	cli();
+	int us = calibration.excess;
+	sei();
+	return us;
+}
+
+/*
+ * setMarkExcess() -- Correct for a MARK excess of us from now on. Not for the constructor: it enables interrupts.
+ *
+ */
+void LRreceiver::setMarkExcess(int us) {
+	int adjust = us - MARK_EXCESS;
+	int8_t ticks = (adjust + (adjust < 0 ? -USECPERTICK / 2 : USECPERTICK / 2)) / USECPERTICK;
+	cli();
+	calibration.excess = us;
+	cap.markTicks = ticks;
+	cap.markUs = adjust - ticks * USECPERTICK;
+	sei();
+}
+
+/*
+ * getCalibration() -- Copy the histograms calibrate() has gathered, and the excess they make, into result.
+ *
+ */
+void LRreceiver::getCalibration(LRcalibration &result) {
+	cli();
+	result = calibration;
+	sei();
+}
+#endif
+
+/*
+ *
+ * Header classification for decode()
+ *
+ * Every decoder starts by checking the header: the first MARK and the SPACE (or, for a couple of them, the MARK-sized
+ * something) that follows it. Rather than run each decoder until it fails, decode() looks up the header in this
+ * table once and only runs the decoders whose header could match. The ranges are the ones the decoders themselves
+ * test, computed at compile time, so a decoder that's skipped is one that would have failed its first checks anyway.
+ * The pulse distance protocols aren't in it: their headers are in pulseProtocol[], which decodeFrame() checks directly.
+ *
+ * Entries are in order of low mark bound, so the lookup can stop at the first entry whose MARK is too long. Only the
+ * protocols in LR_PROTOCOLS have entries.
+ *
+ * decode() hands classify()'s answer to decodeFrame(). The host benchmark ("LRbench -a") hands it every decoder 
+ * instead, as decode() tried them before the table, to measure what the table saves.
+ *
+ */
+#define HDR_MARK(us)	TICKS_LOW((us) + MARK_EXCESS), TICKS_HIGH((us) + MARK_EXCESS)
+#define HDR_SPACE(us)	TICKS_LOW((us) - MARK_EXCESS), TICKS_HIGH((us) - MARK_EXCESS)
+
+// The protocols headerClass[] has entries for
+#define CLASSIFIED		(PROTOCOL_BIT(SONY) | PROTOCOL_BIT(SANYO) | PROTOCOL_BIT(MITSUBISHI) | PROTOCOL_BIT(RC5) | \
+							PROTOCOL_BIT(RC6))
+
+static const struct {
+	unsigned int markLow, markHigh;				// Range of the first MARK, in ticks
+	unsigned int spaceLow, spaceHigh;			// Range of the entry after it, in ticks
+	unsigned int decoders;						// PROTOCOL_BIT()s of the decoders to try
+} headerClass[] = {
+#if LR_DECODES(MITSUBISHI)
+	{HDR_MARK(MITSUBISHI_HDR_SPACE),	TICKS_LOW(MITSUBISHI_ZERO_MARK + MARK_EXCESS), 
+										TICKS_HIGH(MITSUBISHI_ONE_MARK + MARK_EXCESS),	PROTOCOL_BIT(MITSUBISHI)},
+#endif
+#if LR_DECODES(RC5)
+	{HDR_MARK(RC5_T1),					TICKS_LOW(RC5_T1 - MARK_EXCESS), 
+										TICKS_HIGH(3 * RC5_T1 - MARK_EXCESS),			PROTOCOL_BIT(RC5)},
+#endif
+#if LR_DECODES(SONY)
+	{HDR_MARK(SONY_HDR_MARK),			HDR_SPACE(SONY_HDR_SPACE),						PROTOCOL_BIT(SONY)},
+#endif
+#if LR_DECODES(RC6)
+	{HDR_MARK(RC6_HDR_MARK),			HDR_SPACE(RC6_HDR_SPACE),						PROTOCOL_BIT(RC6)},
+#endif
+#if LR_DECODES(SANYO)
+	{HDR_MARK(SANYO_HDR_MARK),			HDR_MARK(SANYO_HDR_MARK),						PROTOCOL_BIT(SANYO)},
+#endif
+	{0xFFFF, 0,							0, 0,											0},	// Sentinel: no MARK is that long
+};
+
+/*
+ * classifyHeader() -- Return the PROTOCOL_BIT()s of the decoders whose header could start with mark, space.
+ *
+ */
+static unsigned int classifyHeader(unsigned int mark, unsigned int space) {
+	unsigned int candidates = 0;
+	for (uint8_t i = 0; i < sizeof(headerClass) / sizeof(headerClass[0]); i++) {
+		if (mark < headerClass[i].markLow) {				// Table is sorted, so nothing after this can match
+			break;
+		}
+		if (mark <= headerClass[i].markHigh && space >= headerClass[i].spaceLow && space <= headerClass[i].spaceHigh) {
+			candidates |= headerClass[i].decoders;
+		}
+	}
+	return candidates;
+}
+
+/*
+ * classify() -- Return the PROTOCOL_BIT()s of the decoders that could match the frame in rawbuf.
+ *
+ */
+unsigned int LRreceiver::classify() {
+	if (rawlen < 4) {										// Too short for anybody's header
+		return 0;
+	}
+	return classifyHeader(rawTicks(1), rawTicks(2));
+}
+
+#if PULSE_PROTOCOLS != 0
+/*
+ *
+ * Pulse distance protocols
+ *
+ * NEC, Panasonic, LG, JVC and Samsung frames are all a header, then a fixed number of bits, each a MARK of fixed 
+ * length and a SPACE whose length is the bit, and maybe a MARK to end the data. One row of pulseProtocol[] describes 
+ * each of them; decodePulseDistance() decodes a frame in rawbuf with a row, and the streaming decoders use the same 
+ * rows as the frame arrives. Another protocol of the kind is a row here (and its PULSE_PROTOCOLS count in LRremote.h).
+ *
+ * A NEC or Samsung repeat is a header whose SPACE is short, then a bit MARK: a row with no bits, ahead of the row 
+ * for the protocol's frames. A JVC repeat is a frame without its header.
+ *
  */
-int recvpin;							// Pin that the IR receiver is attached to
-volatile int rcvstate;					// The state of the ISR state machine
-volatile unsigned int timer;			// State timer, counts 50uS ticks.
-volatile unsigned int rawbuf[RAWBUF];	// Raw data
-volatile unsigned int rawlen;			// Counter of entries in rawbuf
+#define STOP_NONE 0									// Frame ends with the last data SPACE
+#define STOP_ANY 1									// Frame ends with a MARK after the data, not checked
+#define STOP_MARK 2									// Frame ends with a bit MARK after the data
+
+// In the order decodeFrame() tries them. Bounds are [low, high] in ticks.
+struct PulseProtocol {
+	int8_t decode_type;
+	uint8_t bits;									// Number of data bits; 0 for a repeat
+	uint8_t stop;									// STOP_NONE, STOP_ANY or STOP_MARK
+	bool bareRepeat;								// The frame without its header is a repeat (JVC)
+	uint8_t hdrMark[2], hdrSpace[2], bitMark[2], oneSpace[2], zeroSpace[2];
+};
+
+static const PulseProtocol pulseProtocol[] PROGMEM = {
+#if LR_DECODES(NEC)
+	{NEC,		0,				STOP_MARK,	false,	{HDR_MARK(NEC_HDR_MARK)},		{HDR_SPACE(NEC_RPT_SPACE)},
+		{HDR_MARK(NEC_BIT_MARK)},		{0, 0},								{0, 0}},
+	{NEC,		NEC_BITS,		STOP_ANY,	false,	{HDR_MARK(NEC_HDR_MARK)},		{HDR_SPACE(NEC_HDR_SPACE)},
+		{HDR_MARK(NEC_BIT_MARK)},		{HDR_SPACE(NEC_ONE_SPACE)},			{HDR_SPACE(NEC_ZERO_SPACE)}},
+#endif
+#if LR_DECODES(PANASONIC)
+	{PANASONIC,	PANASONIC_BITS,	STOP_NONE,	false,	{HDR_MARK(PANASONIC_HDR_MARK)},	{HDR_MARK(PANASONIC_HDR_SPACE)},
+		{HDR_MARK(PANASONIC_BIT_MARK)},	{HDR_SPACE(PANASONIC_ONE_SPACE)},	{HDR_SPACE(PANASONIC_ZERO_SPACE)}},
+#endif
+#if LR_DECODES(LG)
+	{LG,		LG_BITS,		STOP_MARK,	false,	{HDR_MARK(LG_HDR_MARK)},		{HDR_SPACE(LG_HDR_SPACE)},
+		{HDR_MARK(LG_BIT_MARK)},		{HDR_SPACE(LG_ONE_SPACE)},			{HDR_SPACE(LG_ZERO_SPACE)}},
+#endif
+#if LR_DECODES(JVC)
+	{JVC,		JVC_BITS,		STOP_MARK,	true,	{HDR_MARK(JVC_HDR_MARK)},		{HDR_SPACE(JVC_HDR_SPACE)},
+		{HDR_MARK(JVC_BIT_MARK)},		{HDR_SPACE(JVC_ONE_SPACE)},			{HDR_SPACE(JVC_ZERO_SPACE)}},
+#endif
+#if LR_DECODES(SAMSUNG)
+	{SAMSUNG,	0,				STOP_MARK,	false,	{HDR_MARK(SAMSUNG_HDR_MARK)},	{HDR_SPACE(SAMSUNG_RPT_SPACE)},
+		{HDR_MARK(SAMSUNG_BIT_MARK)},	{0, 0},								{0, 0}},
+	{SAMSUNG,	SAMSUNG_BITS,	STOP_ANY,	false,	{HDR_MARK(SAMSUNG_HDR_MARK)},	{HDR_SPACE(SAMSUNG_HDR_SPACE)},
+		{HDR_MARK(SAMSUNG_BIT_MARK)},	{HDR_SPACE(SAMSUNG_ONE_SPACE)},		{HDR_SPACE(SAMSUNG_ZERO_SPACE)}},
+#endif
+};
+static_assert(sizeof(pulseProtocol) / sizeof(pulseProtocol[0]) == PULSE_PROTOCOLS, 
+	"PULSE_PROTOCOLS (LRremote.h) doesn't match pulseProtocol[]");
+
+#define IN_BOUNDS_P(ticks, bounds) matchTicks((ticks), pgm_read_byte(&(bounds)[0]), pgm_read_byte(&(bounds)[1]))
 
 /*
- * Constructor for LRremote object
+ * pulseHeader() -- Could a frame that starts with mark, space be row's (in flash): is that its header, or, if it has 
+ * them, the first bit of a bare repeat? Like classifyHeader(), a step every frame takes, not a decoder's match.
+ *
+ */
+static bool pulseHeader(const PulseProtocol *row, unsigned int mark, unsigned int space) {
+#if LR_DECODES(JVC)
+	if (pgm_read_byte(&row->bareRepeat) && mark >= pgm_read_byte(&row->bitMark[0]) && 
+			mark <= pgm_read_byte(&row->bitMark[1])) {
+		return true;
+	}
+#endif
+	return mark >= pgm_read_byte(&row->hdrMark[0]) && mark <= pgm_read_byte(&row->hdrMark[1]) && 
+		space >= pgm_read_byte(&row->hdrSpace[0]) && space <= pgm_read_byte(&row->hdrSpace[1]);
+}
+#endif
+
+#ifdef LATENCY_STATS
+/*
+ *
+ * Latency statistics
  *
- * rpin is the pin to which the IR receiver is attached.
+ * Each frame is timed at four points: when its first MARK starts (record()), when the ISR has all of it (frameDone()),
+ * when service() has decoded and queued it, and when the sketch acts on it (dispatched()). The differences go into 
+ * the histograms in latencyStats, which are shared by every receiver. service() counts capture and decode, and 
+ * dispatched() the other two; since service() can run in the bottom half, getLatency() disables interrupts to read 
+ * them.
  *
  */
-LRremote::LRremote(int rpin) {
-	recvpin = rpin;						// Remember which pin the IR receiver is on
-  
-	lastValue = repeat = 0;				// Init lastValue and repeat
-	rcvstate = STATE_IDLE;				// Initialize state machine variables
-	rawlen = 0;
-	pinMode(recvpin, INPUT);			// Set pin mode so we can read the IR receiver
 
+/*
+ * addLatency() -- Count a latency of us microseconds in histogram[]. A bucket that's full stays full.
+ *
+ */
+static void addLatency(uint16_t histogram[], unsigned long us) {
+	uint8_t bucket = 0;
+	for (us >>= 6; us != 0 && bucket < LATENCY_BUCKETS - 1; us >>= 1) {
+		bucket++;
+	}
+	if (histogram[bucket] != 0xFFFF) {
+		histogram[bucket]++;
+	}
 }
 
 /*
- * enable() -- Enable timer interrupts.
+ * getLatency() -- Copy the latency histograms into histogram, clearing them if reset is true.
  *
- * Needs to be a separate method invoked during setup(). Can't do it in the constructor because the Arduino
- * environment messes with the timer during reset.
+ */
+void LRreceiver::getLatency(LRlatency &histogram, bool reset) {
+	cli();
+	histogram = latencyStats;
+	if (reset) {
+		memset(&latencyStats, 0, sizeof(latencyStats));
+	}
+	sei();
+}
+
+/*
+ * printLatency() -- Print the latency histograms to out, one line per bucket: its upper bound in microseconds, then
+ * the count in it for capture, decode, dispatch and total.
  *
  */
+static void printColumn(Print &out, unsigned long n, uint8_t width = 10) {
+	char digits[11];
+	uint8_t len = 0;
+	do {
+		digits[len++] = '0' + n % 10;
+		n /= 10;
+	} while (n != 0);
+	for (uint8_t pad = len; pad < width; pad++) {
+		out.print(' ');
+	}
+	while (len > 0) {
+		out.print(digits[--len]);
+	}
+}
 
-void LRremote::enable() {
-	cli();								// Disable interrupts
-	TIMER_CONFIG_NORMAL();				// Set clock interrupt interval to 50ms
-	TIMER_ENABLE_INTR;					// Enable clock interrupt
-	TIMER_RESET;						// Reset timer
-	sei();								// Enable interrupts
+void LRreceiver::printLatency(Print &out) {
+	LRlatency histogram;
+	getLatency(histogram);
+	out.println(" latency us   capture    decode  dispatch     total");
+	for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+		if (i < LATENCY_BUCKETS - 1) {
+			out.print('<');
+			printColumn(out, 64UL << i);
+		} else {
+			out.print(">=");
+			printColumn(out, 64UL << (i - 1), 9);
+		}
+		printColumn(out, histogram.capture[i]);
+		printColumn(out, histogram.decode[i]);
+		printColumn(out, histogram.dispatch[i]);
+		printColumn(out, histogram.total[i]);
+		out.println();
+	}
+}
+#endif
+
+/*
+ * dispatched() -- Note that event, from read(), has been acted on. onButton() calls this when it calls a button 
+ * function; a sketch using read() or poll() can call it when it has done whatever it does. With LATENCY_STATS it 
+ * counts the event's dispatch and total latencies; otherwise it does nothing.
+ *
+ */
+void LRreceiver::dispatched(const LRevent &event) {
+#ifdef LATENCY_STATS
+	unsigned long now = micros();
+	addLatency(latencyStats.dispatch, now - event.decoded);
+	addLatency(latencyStats.total, now - event.start);
+#else
+	(void)event;
+#endif
 }
 
 /*
- * Timer interrupt service routine (ISR) to collect raw data.
+ * service() -- Decode the transmissions waiting in the frame slots, release the slots and queue the results for read().
  *
- * Durations, measured in 50 microsecond ticks, of alternating SPACE, MARK are recorded in rawbuf[].
- * The count of entries recorded so far is in rawlen. The first entry is the long SPACE between transmissions.
+ * The bottom half of the ISRs calls this (with ISR_BOTTOM_HALF), and so does read(). A sketch that spends a long time
+ * away from read() with ISR_BOTTOM_HALF turned off can call it to keep the slots free. Only one service() runs at a 
+ * time: if another is under way, in the code this one interrupted, this one leaves the work to it.
  *
- * The ISR is a state machine driven by data received through the IR receiver. It starts in STATE_IDLE. At
- * each clock tick, the state of the IR receiver is sampled and, based on the current state of the state 
- * machine and the IR receiver state, duration of each MARK and SPACE in the sequence is recorded. Normally,
- * a sequence ends with a long SPACE. It can also end -- abnormally -- by filling up the buffer. In either case
- * when the sequence ends, recording stops and the machine remains in STATE_STOP until it's reset to 
- * STATE_IDLE by LRremote::resume().
+ * The queue is a ring of EVENT_QUEUE events. service() fills events[eventHead % EVENT_QUEUE] and only then counts it in
+ * eventHead; read() empties events[eventTail % EVENT_QUEUE] and only then counts it in eventTail. Each side writes
+ * just its own single-byte count, so neither needs to disable interrupts to use the queue. A transmission that finds 
+ * the queue full is counted in eventDrops.
  *
  */
-ISR(TIMER_INTR_NAME) {
-	TIMER_RESET;
-
-	uint8_t irdata = (uint8_t)digitalRead(recvpin);			// Sample the state of the IR receiver
-
-	timer++;												// Count one more 50us tick.
-	if (rawlen >= RAWBUF) {									// If the buffer is full to capacity
-		rcvstate = STATE_STOP;								//  We had a transmission error. Stop recording.
-	}
-	switch(rcvstate) {
-		case STATE_IDLE:									// We're idling, supposedly in the middle of a gap
-			if (irdata == MARK) {							//   If it looks like that just ended
-				if (timer < GAP_TICKS) {					//     Make sure it's big enough to be real.
-					timer = 0;								//     If not ignore it.
-				} else {									//     Else gap just ended
-					rawlen = 0;								//       Record duration and start recording transmission
-					rawbuf[rawlen++] = timer;
-					timer = 0;
-					rcvstate = STATE_MARK;
-				}
-			} else if (timer > GAP_TICKS) {					//   Else the gap continues
-				timer = GAP_TICKS;							//     We just need to know it's a long one, not overflow
+void LRreceiver::service() {
+	cli();
+	if (servicing) {										// If somebody's already at it
+		sei();												//   Leave it to them
+		return;
+	}
+	servicing = true;
+	sei();
+	for (;;) {
+		if (decode()) {										// If a transmission was decoded
+			LR_STAT(decoded[LR_STAT_TYPE(decode_type)]);
+#ifdef CALIBRATE_EXCESS
+			if (calibrating) {
+				measureExcess();
 			}
-			break;
-		case STATE_MARK:									// We're timing a MARK
-			if (irdata == SPACE) {  						//  If the MARK ended
-				rawbuf[rawlen++] = timer;					//    Record the duration
-				timer = 0;
-				rcvstate = STATE_SPACE;						//    and start recording the SPACE that follows
-			}
-			break;
-		case STATE_SPACE:									// We're timing a SPACE
-			if (irdata == MARK) {							// If the SPACE just ended
-				rawbuf[rawlen++] = timer;					//   Record the duration
-				timer = 0;
-				rcvstate = STATE_MARK;						//   and start recording the MARK that follows
-			} else {										// Else the SPACE continues
-				if (timer >= GAP_TICKS) {					//   If it's a long space
-					rcvstate = STATE_STOP;					//   We're done recording the sequence. No recording
-				}											//     until someone processes it.
+#endif
+			uint8_t head = eventHead;
+			if ((uint8_t)(head - eventTail) >= EVENT_QUEUE) {	//   Queue it, if there's room
+				eventDrops++;
+				LR_STAT(queueDrops);
+			} else {
+				volatile LRevent &event = events[head % EVENT_QUEUE];
+				event.decode_type = decode_type;
+				event.bits = bits;
+				event.value = value;
+				event.address = panasonicAddress;
+#ifdef HASH_64
+				event.hashHigh = decode_type == UNKNOWN ? hashHigh : 0;
+#endif
+				event.time = cap.frameTime[cap.frameTail % RAWFRAMES];
+#ifdef LATENCY_STATS
+				event.start = cap.frameStart[cap.frameTail % RAWFRAMES];
+				event.decoded = micros();
+				addLatency(latencyStats.capture, event.time - event.start);
+				addLatency(latencyStats.decode, event.decoded - event.time);
+#endif
+				LR_FRAME_DECODED(*this);
+				eventHead = head + 1;
 			}
-			break;
-		case STATE_STOP:									// We're waiting for someone to process what we recorded
-			timer = 0;										//   Nothing interesting going on; no need to count
-			break;
+			resume();										//   And release its slot
+		} else if (cap.frameHead == cap.frameTail) {		// Else if nothing's waiting (decode() released anything
+			break;											//   it didn't recognize), we're done
+		}
 	}
+	servicing = false;
 }
 
 /*
- *
- * Resume recording transmissions.
- *
- * Restart the ISR state machine: STAT_STOP -> STATE_IDLE
+ * read() -- Get the next decoded transmission. Returns false, without waiting, if there isn't one.
  *
  */
+bool LRreceiver::read(LRevent &event) {
+	service();
+	uint8_t tail = eventTail;
+	if (tail == eventHead) {
+		return false;
+	}
+	volatile LRevent &queued = events[tail % EVENT_QUEUE];
+	event.decode_type = queued.decode_type;
+	event.bits = queued.bits;
+	event.value = queued.value;
+	event.address = queued.address;
+#ifdef HASH_64
+	event.hashHigh = queued.hashHigh;
+#endif
+	event.time = queued.time;
+#ifdef LATENCY_STATS
+	event.start = queued.start;
+	event.decoded = queued.decoded;
+#endif
+	eventTail = tail + 1;									// Only now is the slot free for service()
+	return true;
+}
 
-void LRremote::resume() {
-	rawlen = 0;												// Restart recording from beginning of buffer
-	rcvstate = STATE_IDLE;									// ISR state machine starts in idle state
+/*
+ * poll() -- Get what the next decoded transmission was, for a sketch that has no use for when it arrived. Returns 
+ * false, without waiting, if there isn't one.
+ *
+ */
+bool LRreceiver::poll(DecodeResult &result) {
+	LRevent event;
+	if (!read(event)) {
+		return false;
+	}
+	result = event;
+	return true;
 }
 
 /*
@@ -143,80 +1201,198 @@ void LRremote::resume() {
  * Returns false if no data ready, true if data ready. When true is returned, the results of decoding are 
  * stored in value and related private instance variables.
  *
+ * If the streaming decoders already worked out what the frame is, that's the answer. Otherwise it's decoded here.
+ * Only the decoders classify() says could match are tried, in the order Sony, Sanyo, Mitsubishi, RC5, RC6, then 
+ * the pulse distance protocols whose header the frame has, in pulseProtocol[] order: NEC, Panasonic, LG, JVC, Samsung.
+ * (No header fits both kinds, so that's the same as it was with NEC first.) Anything none of them claims is 
+ * compared with the learned templates, and if it isn't one of those either, hashed. While learn() is waiting for a
+ * frame, the frame is learned instead.
+ *
  */
-bool LRremote::decode() {
-	if (rcvstate != STATE_STOP) {
+bool LRreceiver::decode() {
+	if (cap.captureMode == CAPTURE_EDGE) {
+		frameEnded(cap);
+	}
+	if (cap.frameHead == cap.frameTail) {					// If there's nothing waiting to be decoded
+		return false;
+	}
+	rawbuf = (const uint8_t *)frameSlot(cap, cap.frameTail);	// Decode the oldest waiting frame. The ISR
+	rawlen = cap.framelen[cap.frameTail % RAWFRAMES];			//   won't touch it until resume().
+	rawgap = cap.framegap[cap.frameTail % RAWFRAMES];
+#if LR_DECODES(LEARNED)
+	LRtemplate *tmpl = learnInto;
+	if (tmpl != 0) {										// If we're learning, this frame is the one to learn
+		if (makeTemplate(*tmpl)) {							//   (if it'll make a template)
+			learnInto = 0;
+		}
+		resume();											//   rather than one to decode
 		return false;
 	}
-#ifdef DEBUG
-	Serial.println("Attempting NEC decode");
 #endif
-	if (decodeNEC()) {
+#ifdef STREAM_DECODE
+	volatile DecodeResult &streamed = cap.frameResult[cap.frameTail % RAWFRAMES];
+	if (streamed.decode_type != 0) {
+		decode_type = streamed.decode_type;
+		bits = streamed.bits;
+		value = streamed.value;
+		panasonicAddress = streamed.address;
 		return true;
 	}
-#ifdef DEBUG
-	Serial.println("Attempting Sony decode");
 #endif
-	if (decodeSony()) {
+	if (decodeFrame((LR_PROTOCOLS & CLASSIFIED) != 0 ? classify() : 0)) {
 		return true;
 	}
-#ifdef DEBUG
-	Serial.println("Attempting Sanyo decode");
+	// Unrecognized; throw away and start over
+#ifdef DECODE_STATS
+	if (rawlen < 6) {
+		LR_STAT(noise);
+#ifdef VALIDATE_FRAMES
+	} else if (invalid) {
+		LR_STAT(invalid);
 #endif
-	if (decodeSanyo()) {
-		return true;
+	} else {
+		LR_STAT(unrecognized);
 	}
+#endif
+	resume();
+	return false;
+}
+
+/*
+ *
+ * Decode the frame in rawbuf. Returns true, with the results in value and related private instance variables,
+ * if any decoder recognized it. Of the decoders headerClass[] covers, only the ones in candidates (PROTOCOL_BIT()s, 
+ * usually from classify()) are tried.
+ *
+ */
+bool LRreceiver::decodeFrame(unsigned int candidates) {
+#ifdef VALIDATE_FRAMES
+	invalid = false;
+#endif
+#if LR_DECODES(SONY)
+	if (candidates & PROTOCOL_BIT(SONY)) {
 #ifdef DEBUG
-	Serial.println("Attempting Mitsubishi decode");
+		Serial.println("Attempting Sony decode");
 #endif
-	if (decodeMitsubishi()) {
-		return true;
+		if (decodeSony()) {
+			return true;
+		}
+		LR_STAT(rejected[SONY]);
 	}
+#endif
+#if LR_DECODES(SANYO)
+	if (candidates & PROTOCOL_BIT(SANYO)) {
 #ifdef DEBUG
-	Serial.println("Attempting RC5 decode");
-#endif  
-	if (decodeRC5()) {
-		return true;
+		Serial.println("Attempting Sanyo decode");
+#endif
+		if (decodeSanyo()) {
+			return true;
+		}
+		LR_STAT(rejected[SANYO]);
 	}
+#endif
+#if LR_DECODES(MITSUBISHI)
+	if (candidates & PROTOCOL_BIT(MITSUBISHI)) {
 #ifdef DEBUG
-	Serial.println("Attempting RC6 decode");
-#endif 
-	if (decodeRC6()) {
-		return true;
+		Serial.println("Attempting Mitsubishi decode");
+#endif
+		if (decodeMitsubishi()) {
+			return true;
+		}
+		LR_STAT(rejected[MITSUBISHI]);
 	}
+#endif
+#if LR_DECODES(RC5)
+	if (candidates & PROTOCOL_BIT(RC5)) {
 #ifdef DEBUG
-	Serial.println("Attempting Panasonic decode");
-#endif 
-	if (decodePanasonic()) {
-		return true;
+		Serial.println("Attempting RC5 decode");
+#endif
+		if (decodeRC5()) {
+			return true;
+		}
+		LR_STAT(rejected[RC5]);
 	}
+#endif
+#if LR_DECODES(RC6)
+	if (candidates & PROTOCOL_BIT(RC6)) {
 #ifdef DEBUG
-	Serial.println("Attempting LG decode");
-#endif 
-	if (decodeLG()) {
-		return true;
+		Serial.println("Attempting RC6 decode");
+#endif
+		if (decodeRC6()) {
+			return true;
+		}
+		LR_STAT(rejected[RC6]);
 	}
+#endif
+#if PULSE_PROTOCOLS != 0
+	if (rawlen >= 4) {									// Long enough for a header
+		unsigned int mark = rawTicks(1), space = rawTicks(2);
+		for (uint8_t i = 0; i < PULSE_PROTOCOLS; i++) {
+			if (!pulseHeader(&pulseProtocol[i], mark, space)) {
+				continue;
+			}
+			PulseProtocol p;
+			memcpy_P(&p, &pulseProtocol[i], sizeof(p));
 #ifdef DEBUG
-	Serial.println("Attempting JVC decode");
-#endif 
-	if (decodeJVC()) {
-		return true;
+			Serial.print("Attempting pulse distance decode, type ");
+			Serial.println(p.decode_type);
+#endif
+			if (decodePulseDistance(p)) {
+				return true;
+			}
+			LR_STAT(rejected[p.decode_type]);
+#ifdef VALIDATE_FRAMES
+			if (invalid) {								// An NEC or Samsung frame, but a bad one: nothing else gets it
+				return false;
+			}
+#endif
+		}
 	}
-#ifdef DEBUG
-	Serial.println("Attempting SAMSUNG decode");
 #endif
-	if (decodeSAMSUNG()) {
-		return true;
+#if LR_DECODES(LEARNED)
+	if (templateCount != 0) {
+		if (decodeLearned()) {
+			return true;
+		}
+		LR_STAT(rejected[LEARNED]);
 	}
+#endif
 	// decodeHash returns a hash on any input.
 	// Thus, it needs to be last in the list.
 	// If you add any decodes, add them before this.
-	if (decodeHash()) {
-		return true;
-	}
-	// Unrecognized; throw away and start over
-	resume();
+#if LR_DECODES(UNKNOWN)
+	return decodeHash();
+#else
 	return false;
+#endif
+}
+
+/*
+ * rawTicks() -- Return entry ix of rawbuf, in ticks: one byte or two, whichever the LRremoteBuf has.
+ *
+ * The decoders read rawbuf only through this and gapTicks(). It isn't inline: the test of the entry size at every one
+ * of the decoders' reads would take more flash than the call.
+ *
+ */
+unsigned int LRreceiver::rawTicks(unsigned int ix) {
+	return cap.rawSize == 1 ? rawbuf[ix] : ((const uint16_t *)rawbuf)[ix];
+}
+
+/*
+ * gapTicks() -- Return the length of the gap before the frame in rawbuf, in ticks.
+ *
+ * The gap is the one entry that can be escaped and still matter; see record().
+ *
+ */
+unsigned int LRreceiver::gapTicks() {
+	unsigned int ticks = rawTicks(0);
+	return ticks == cap.rawLong ? rawgap : ticks;
+}
+
+// Test whether measured lies in [low, high]
+static inline bool matchTicks(unsigned int measured, unsigned int low, unsigned int high) {
+	LR_COUNT(matches);
+	return measured >= low && measured <= high;
 }
 
 // Two versions of MATCH, MATCH_MARK, and MATCH_SPACE the first for debugging the second -- macros -- for production
@@ -259,10 +1435,187 @@ int MATCH_SPACE(int measured_ticks, int desired_us) {
 	return measured_ticks >= TICKS_LOW(desired_us - MARK_EXCESS) && measured_ticks <= TICKS_HIGH(desired_us - MARK_EXCESS);
 }
 #else
-int MATCH(int measured, int desired) {return measured >= TICKS_LOW(desired) && measured <= TICKS_HIGH(desired);}
-int MATCH_MARK(int measured_ticks, int desired_us) {return MATCH(measured_ticks, (desired_us + MARK_EXCESS));}
-int MATCH_SPACE(int measured_ticks, int desired_us) {return MATCH(measured_ticks, (desired_us - MARK_EXCESS));}
-// Debugging versions are in IRremote.cpp
+// The desired durations are always constants, so each MATCH boils down to two compares against precomputed bounds.
+#define MATCH(measured, desired) matchTicks((measured), TICKS_LOW(desired), TICKS_HIGH(desired))
+#define MATCH_MARK(measured_ticks, desired_us) MATCH((measured_ticks), (desired_us) + MARK_EXCESS)
+#define MATCH_SPACE(measured_ticks, desired_us) MATCH((measured_ticks), (desired_us) - MARK_EXCESS)
+#endif
+
+#ifdef VALIDATE_FRAMES
+/*
+ *
+ * Frame validation
+ *
+ * An NEC frame is an address byte, its complement, a command byte and its complement, each sent least significant bit
+ * first; a Samsung frame is the same but with the address byte sent twice. (Extended NEC spends the complement on a
+ * 16-bit address.) Decoded most significant bit first as they are here, each byte comes out reversed, which leaves 
+ * the complements complements. A frame that's been hit by noise but still has the right timing almost never has them
+ * right, so checking them weeds it out before onButton() can act on it.
+ *
+ * Without setAddress() the address has to be a byte and its complement (NEC) or the same byte twice (Samsung), so an
+ * extended NEC remote's frames are only taken once setAddress() has been given its address. The decoders check the 
+ * address as soon as its 16 bits are in and give up on the frame there and then if it's wrong, and the command once
+ * the frame is complete. A frame that fails either way is an NEC or Samsung frame with bad bits, so decodeFrame() 
+ * drops it rather than let LG, say, or the hash have a go.
+ *
+ */
+
+#if LR_DECODES(NEC) || LR_DECODES(SAMSUNG)
+/*
+ * frameValid() -- Are data, the first count bits (16 or 32) of a type frame, as they should be for c? Only NEC and 
+ * Samsung frames carry anything to check; any other type is valid.
+ *
+ */
+static bool frameValid(const LRcapture &c, int8_t type, unsigned long data, uint8_t count) {
+	if (type != NEC && type != SAMSUNG) {
+		return true;
+	}
+	if (count == 16) {										// The address
+		if (c.address >= 0) {
+			return data == (unsigned long)c.address;
+		}
+		return type == SAMSUNG ? (data >> 8) == (data & 0xFF) : ((data >> 8 ^ data) & 0xFF) == 0xFF;
+	}
+	return ((data >> 8 ^ data) & 0xFF) == 0xFF;				// The command and its complement
+}
+#endif
+
+/*
+ * setAddress() -- Take NEC and Samsung frames only from the remote at address: the first 16 bits of the frame, the top
+ * 16 of its value, e.g. 0x10EF for a value of 0x10EFD827. -1 takes them from any remote again.
+ *
+ */
+void LRreceiver::setAddress(long address) {
+	cli();
+	cap.address = address;
+	sei();
+}
+#endif
+
+#ifdef STREAM_DECODE
+/*
+ *
+ * Streaming decode
+ *
+ * The pulse distance protocols are decoded by the ISR as the frame arrives. record() hands each entry to 
+ * streamEntry(), which steps a bit assembler for each of the rows of pulseProtocol[] that the frame still 
+ * matches, keeping its state in the receiver's LRcapture. The moment one of them has a whole frame, and no decoder
+ * that decode() would try ahead of it could still want the frame, the frame is over: there's no need to wait for the
+ * gap after it, and decode() has nothing left to do but pick up the result. A frame none of them claims ends at the
+ * gap and is decoded by decode() as always.
+ *
+ * The rows are the ones decodePulseDistance() uses, and a protocol claims a frame only if decode() would have 
+ * decoded it the same way. The one difference is that a NEC or Samsung repeat is taken as soon as its MARK ends; 
+ * decode() insists that there be nothing after it. A JVC repeat, having no header, is left to decode().
+ *
+ */
+
+/*
+ * streamEntry() -- Step the streaming decoders with entry ix of the frame being recorded. Called from record().
+ *
+ */
+static void streamEntry(LRcapture &c, unsigned int ix, unsigned int ticks) {
+	if (ix == 0) {											// The gap: a new frame. Everybody's in the running.
+		c.streamAlive = (1 << PULSE_PROTOCOLS) - 1;
+		c.streamDone = 0;
+		return;
+	}
+	if (ix == 2) {											// Header complete. Who else could be interested?
+		c.streamBlockers = classifyHeader(rawEntry(c, c.capbuf, 1), ticks);
+	}
+	uint8_t bit = 1;
+	for (uint8_t i = 0; i < PULSE_PROTOCOLS; i++, bit <<= 1) {
+		if (!(c.streamAlive & bit)) {
+			continue;
+		}
+		const PulseProtocol *p = &pulseProtocol[i];			// In flash: read a field at a time, as it's needed
+		uint8_t bits = pgm_read_byte(&p->bits);
+		uint8_t stop = pgm_read_byte(&p->stop);
+		unsigned int lastSpace = 2 * bits + 2;				// Index of the last data SPACE, unsigned like ix
+		bool ok = true;
+		if (ix == 1) {
+			ok = IN_BOUNDS_P(ticks, p->hdrMark);
+		} else if (ix == 2) {
+			ok = IN_BOUNDS_P(ticks, p->hdrSpace);
+		} else if (ix > lastSpace) {						// The MARK after the data
+			ok = stop == STOP_ANY || IN_BOUNDS_P(ticks, p->bitMark);
+		} else if (ix & 1) {								// A bit's MARK
+			ok = IN_BOUNDS_P(ticks, p->bitMark);
+		} else if (IN_BOUNDS_P(ticks, p->oneSpace)) {		// A bit's SPACE
+			if (bits > 32) {
+				c.streamHigh = (c.streamHigh << 1) | (c.streamValue[i] >> 31);
+			}
+			c.streamValue[i] = (c.streamValue[i] << 1) | 1;
+		} else if (IN_BOUNDS_P(ticks, p->zeroSpace)) {
+			if (bits > 32) {
+				c.streamHigh = (c.streamHigh << 1) | (c.streamValue[i] >> 31);
+			}
+			c.streamValue[i] <<= 1;
+		} else {
+			ok = false;
+		}
+#if defined(VALIDATE_FRAMES) && (LR_DECODES(NEC) || LR_DECODES(SAMSUNG))
+		// An NEC or Samsung address or command just in, and it's bad? Then nobody streams the frame: it's left for
+		// decodeFrame() to drop.
+		int8_t type = pgm_read_byte(&p->decode_type);
+		if (ok && (type == NEC || type == SAMSUNG) && bits != 0 && (ix == 2 * 16 + 2 || ix == lastSpace) && 
+				!frameValid(c, type, c.streamValue[i], (ix - 2) / 2)) {
+			c.streamAlive = c.streamDone = 0;
+			break;
+		}
+#endif
+		if (!ok) {
+			c.streamAlive &= ~bit;
+		} else if (ix == lastSpace + (stop != STOP_NONE)) {	// Whole frame
+			c.streamAlive &= ~bit;
+			c.streamDone |= bit;
+		} else if (ix == 2) {
+			c.streamValue[i] = 0;
+			c.streamHigh = 0;
+		}
+	}
+	if (streamWinner(c, false) >= 0) {					// If that settled it, the frame is over
+		frameDone(c);
+	}
+}
+
+/*
+ * streamWinner() -- Return the index in pulseProtocol[] of the protocol the frame is, or -1 if that isn't known.
+ *
+ * The answer is the first protocol that's still in the running, provided it has matched a whole frame and none of 
+ * the decoders that can't be streamed, which decode() tries first, could want the frame. When the frame has ended, 
+ * protocols that were still waiting for more of it are out of the running.
+ *
+ */
+static int8_t streamWinner(LRcapture &c, bool ended) {
+	uint8_t bit = 1;
+	for (uint8_t i = 0; i < PULSE_PROTOCOLS; i++, bit <<= 1) {
+		if (c.streamDone & bit) {
+			return c.streamBlockers != 0 ? -1 : i;
+		}
+		if (!ended && (c.streamAlive & bit)) {
+			return -1;
+		}
+	}
+	return -1;
+}
+
+/*
+ * streamResult() -- Set result to what pulseProtocol[winner] decoded; nothing if winner is -1.
+ *
+ */
+static void streamResult(LRcapture &c, volatile DecodeResult &result, int8_t winner) {
+	c.streamAlive = c.streamDone = 0;
+	if (winner < 0) {
+		result.decode_type = 0;
+		return;
+	}
+	uint8_t bits = pgm_read_byte(&pulseProtocol[winner].bits);
+	result.decode_type = pgm_read_byte(&pulseProtocol[winner].decode_type);
+	result.bits = bits;
+	result.value = bits == 0 ? REPEAT : c.streamValue[winner];
+	result.address = bits > 32 ? c.streamHigh : 0;
+}
 #endif
 
 /*
@@ -274,57 +1627,74 @@ int MATCH_SPACE(int measured_ticks, int desired_us) {return MATCH(measured_ticks
  *
  */
 
-// NEC.
-bool LRremote::decodeNEC() {
-	long data = 0;
-	int offset = 1; // Skip first space
-	// Initial mark
-	if (!MATCH_MARK(rawbuf[offset], NEC_HDR_MARK)) {
-		return false;
-	}
-	offset++;
-	// Check for repeat
-	if (rawlen == 4 &&									// NECs have a repeat only 4 items long
-		MATCH_SPACE(rawbuf[offset], NEC_RPT_SPACE) &&
-		MATCH_MARK(rawbuf[offset+1], NEC_BIT_MARK)) {
+#if PULSE_PROTOCOLS != 0
+/*
+ * decodePulseDistance() -- Decode the frame in rawbuf, whose header pulseHeader() has found to be p's, as p, a copy
+ * of a pulseProtocol[] row.
+ *
+ */
+bool LRreceiver::decodePulseDistance(const PulseProtocol &p) {
+	// The bounds it tests, in locals: rawTicks() isn't inline, so fields of p would be fetched again after every call
+	uint8_t markLow = p.bitMark[0], markHigh = p.bitMark[1];
+	uint8_t oneLow = p.oneSpace[0], oneHigh = p.oneSpace[1], zeroLow = p.zeroSpace[0], zeroHigh = p.zeroSpace[1];
+	uint8_t count = p.bits;
+#if LR_DECODES(JVC)
+	if (p.bareRepeat && rawTicks(1) < p.hdrMark[0]) {		// Too short for the header, so a bare repeat
+		if (rawlen != 2U * count + 2 || !matchTicks(rawTicks(rawlen - 1), markLow, markHigh)) {
+			return false;
+		}
 		bits = 0;
 		value = REPEAT;
-		decode_type = NEC;
+		decode_type = p.decode_type;
 		return true;
 	}
-	if (rawlen < 2 * NEC_BITS + 4) {
-		return false;
-	}
-	// Initial space
-	if (!MATCH_SPACE(rawbuf[offset], NEC_HDR_SPACE)) {
+#endif
+	// Long enough for the header, the bits and any MARK after them. A repeat has to have nothing more.
+	if (count == 0 ? rawlen != 4 : rawlen < 2U * count + 3 + (p.stop != STOP_NONE)) {
 		return false;
 	}
-	offset++;
-	for (int i = 0; i < NEC_BITS; i++) {
-		if (!MATCH_MARK(rawbuf[offset], NEC_BIT_MARK)) {
+	uint32_t data = 0;										// 32 bits on the host too, as streamed
+	unsigned int high = 0;									// Bits shifted out the top of data (Panasonic)
+	unsigned int offset = 3;								// After the header
+	for (uint8_t i = 0; i < count; i++) {
+		if (!matchTicks(rawTicks(offset), markLow, markHigh)) {
 			return false;
 		}
 		offset++;
-		if (MATCH_SPACE(rawbuf[offset], NEC_ONE_SPACE)) {
+#if LR_DECODES(PANASONIC)
+		high = (high << 1) | (data >> 31);
+#endif
+		unsigned int ticks = rawTicks(offset);
+		if (matchTicks(ticks, oneLow, oneHigh)) {
 			data = (data << 1) | 1;
-		} 
-		else if (MATCH_SPACE(rawbuf[offset], NEC_ZERO_SPACE)) {
+		} else if (matchTicks(ticks, zeroLow, zeroHigh)) {
 			data <<= 1;
-		} 
-		else {
+		} else {
 			return false;
 		}
 		offset++;
+#if defined(VALIDATE_FRAMES) && (LR_DECODES(NEC) || LR_DECODES(SAMSUNG))
+		if ((p.decode_type == NEC || p.decode_type == SAMSUNG) && (i == 15 || i == 31) && 
+				!frameValid(cap, p.decode_type, data, i + 1)) {
+			invalid = true;
+			return false;
+		}
+#endif
 	}
-	// Success
-	bits = NEC_BITS;
-	value = data;
-	decode_type = NEC;
+	if (p.stop == STOP_MARK && !matchTicks(rawTicks(offset), markLow, markHigh)) {
+		return false;
+	}
+	bits = count;
+	value = count == 0 ? REPEAT : data;
+	panasonicAddress = high;
+	decode_type = p.decode_type;
 	return true;
 }
+#endif
 
+#if LR_DECODES(SONY)
 // Sony.
-bool LRremote::decodeSony() {
+bool LRreceiver::decodeSony() {
 	long data = 0;
 	if (rawlen < 2 * SONY_BITS + 2) {
 		return false;
@@ -333,30 +1703,30 @@ bool LRremote::decodeSony() {
 
 	// Some Sony's deliver repeats fast after first
 	// unfortunately can't spot difference from of repeat from two fast clicks
-	if (rawbuf[offset] < SONY_DOUBLE_SPACE_USECS) {
+	if (gapTicks() < SONY_DOUBLE_SPACE_TICKS) {
 		// Serial.print("IR Gap found: ");
 		bits = 0;
 		value = REPEAT;
-		decode_type = SANYO;
+		decode_type = SONY;
 		return true;
 	}
 	offset++;
 
 	// Initial mark
-	if (!MATCH_MARK(rawbuf[offset], SONY_HDR_MARK)) {
+	if (!MATCH_MARK(rawTicks(offset), SONY_HDR_MARK)) {
 		return false;
 	}
 	offset++;
 
 	while (offset + 1 < rawlen) {
-		if (!MATCH_SPACE(rawbuf[offset], SONY_HDR_SPACE)) {
+		if (!MATCH_SPACE(rawTicks(offset), SONY_HDR_SPACE)) {
 			break;
 		}
 		offset++;
-		if (MATCH_MARK(rawbuf[offset], SONY_ONE_MARK)) {
+		if (MATCH_MARK(rawTicks(offset), SONY_ONE_MARK)) {
 			data = (data << 1) | 1;
 		} 
-		else if (MATCH_MARK(rawbuf[offset], SONY_ZERO_MARK)) {
+		else if (MATCH_MARK(rawTicks(offset), SONY_ZERO_MARK)) {
 			data <<= 1;
 		} 
 		else {
@@ -375,9 +1745,11 @@ bool LRremote::decodeSony() {
 	decode_type = SONY;
 	return true;
 }
+#endif
 
+#if LR_DECODES(SANYO)
 // Sanyo. Looks like Sony except for timings, 48 chars of data and time/space different
-bool LRremote::decodeSanyo() {
+bool LRreceiver::decodeSanyo() {
 	long data = 0;
 	if (rawlen < 2 * SANYO_BITS + 2) {
 		return false;
@@ -386,11 +1758,11 @@ bool LRremote::decodeSanyo() {
 	// Initial space
 /* Put this back in for debugging - note can't use #DEBUG as if Debug on we don't see the repeat cos of the delay
 	Serial.print("IR Gap: ");
-	Serial.println( rawbuf[offset]);
+	Serial.println( gapTicks());
 	Serial.println( "test against:");
-	Serial.println(rawbuf[offset]);
+	Serial.println(gapTicks());
 */
-	if (rawbuf[offset] < SANYO_DOUBLE_SPACE_USECS) {
+	if (gapTicks() < SANYO_DOUBLE_SPACE_TICKS) {
 		// Serial.print("IR Gap found: ");
 		bits = 0;
 		value = REPEAT;
@@ -400,26 +1772,26 @@ bool LRremote::decodeSanyo() {
 	offset++;
 
 	// Initial mark
-	if (!MATCH_MARK(rawbuf[offset], SANYO_HDR_MARK)) {
+	if (!MATCH_MARK(rawTicks(offset), SANYO_HDR_MARK)) {
 		return false;
 	}
 	offset++;
 
 	// Skip Second Mark
-	if (!MATCH_MARK(rawbuf[offset], SANYO_HDR_MARK)) {
+	if (!MATCH_MARK(rawTicks(offset), SANYO_HDR_MARK)) {
 		return false;
 	}
 	offset++;
 
 	while (offset + 1 < rawlen) {
-		if (!MATCH_SPACE(rawbuf[offset], SANYO_HDR_SPACE)) {
+		if (!MATCH_SPACE(rawTicks(offset), SANYO_HDR_SPACE)) {
 			break;
 		}
 		offset++;
-		if (MATCH_MARK(rawbuf[offset], SANYO_ONE_MARK)) {
+		if (MATCH_MARK(rawTicks(offset), SANYO_ONE_MARK)) {
 			data = (data << 1) | 1;
 		} 
-		else if (MATCH_MARK(rawbuf[offset], SANYO_ZERO_MARK)) {
+		else if (MATCH_MARK(rawTicks(offset), SANYO_ZERO_MARK)) {
 			data <<= 1;
 		} 
 		else {
@@ -438,9 +1810,11 @@ bool LRremote::decodeSanyo() {
 	decode_type = SANYO;
 	return true;
 }
+#endif
 
+#if LR_DECODES(MITSUBISHI)
 // Mitsubishi. Looks like Sony except for timings, 48 chars of data and time/space different
-bool LRremote::decodeMitsubishi() {
+bool LRreceiver::decodeMitsubishi() {
 /*
 	Serial.print("?!? decoding Mitsubishi: ");
 	Serial.print(rawlen);
@@ -455,12 +1829,12 @@ bool LRremote::decodeMitsubishi() {
 	// Initial space
 /* Put this back in for debugging - note can't use #DEBUG as if Debug on we don't see the repeat cos of the delay
 	Serial.print("IR Gap: ");
-	Serial.println( rawbuf[offset]);
+	Serial.println( gapTicks());
 	Serial.println( "test against:");
-	Serial.println(rawbuf[offset]);
+	Serial.println(gapTicks());
 */
 /* Not seeing double keys from Mitsubishi
-	if (rawbuf[offset] < MITSUBISHI_DOUBLE_SPACE_USECS) {
+	if (rawTicks(offset) < MITSUBISHI_DOUBLE_SPACE_USECS) {
 //		Serial.print("IR Gap found: ");
 		bits = 0;
 		value = REPEAT;
@@ -474,24 +1848,24 @@ bool LRremote::decodeMitsubishi() {
 	// 14200 7 41 7 42 7 42 7 17 7 17 7 18 7 41 7 18 7 17 7 17 7 18 7 41 8 17 7 17 7 18 7 17 7 
 
 	// Initial Space
-	if (!MATCH_MARK(rawbuf[offset], MITSUBISHI_HDR_SPACE)) {
+	if (!MATCH_MARK(rawTicks(offset), MITSUBISHI_HDR_SPACE)) {
 		return false;
 	}
 	offset++;
 	while (offset + 1 < rawlen) {
-		if (MATCH_MARK(rawbuf[offset], MITSUBISHI_ONE_MARK)) {
+		if (MATCH_MARK(rawTicks(offset), MITSUBISHI_ONE_MARK)) {
 			data = (data << 1) | 1;
 		} 
-		else if (MATCH_MARK(rawbuf[offset], MITSUBISHI_ZERO_MARK)) {
+		else if (MATCH_MARK(rawTicks(offset), MITSUBISHI_ZERO_MARK)) {
 			data <<= 1;
 		} 
 		else {
-//			Serial.println("A"); Serial.println(offset); Serial.println(rawbuf[offset]);
+//			Serial.println("A"); Serial.println(offset); Serial.println(rawTicks(offset));
 			return false;
 		}
 		offset++;
-		if (!MATCH_SPACE(rawbuf[offset], MITSUBISHI_HDR_SPACE)) {
-//			Serial.println("B"); Serial.println(offset); Serial.println(rawbuf[offset]);
+		if (!MATCH_SPACE(rawTicks(offset), MITSUBISHI_HDR_SPACE)) {
+//			Serial.println("B"); Serial.println(offset); Serial.println(rawTicks(offset));
 			break;
 		}
 		offset++;
@@ -507,7 +1881,9 @@ bool LRremote::decodeMitsubishi() {
 	decode_type = MITSUBISHI;
 	return true;
 }
+#endif
 
+#if LR_DECODES(RC5) || LR_DECODES(RC6)
 /*
  * getRClevel() helper for RC5/6 decoding
  *
@@ -516,31 +1892,41 @@ bool LRremote::decodeMitsubishi() {
  * and SPACE for 1, successive calls to getRClevel will return MARK, MARK, SPACE.
  *
  * The variables "offset" and "used" are updated to keep track of the current position.
- * The variable "t1" is the time interval for a single bit in microseconds. 
+ * The variable "levels" gives the bounds, in ticks, of a MARK or SPACE of one, two or three time 
+ * intervals; see rc5Levels and rc6Levels.
  *
- * Returns -1 for error (measured time interval is not a multiple of t1).
+ * Returns -1 for error (measured time interval is not a multiple of the time interval).
  *
  */
-int LRremote::getRClevel(int *offset, int *used, int t1) {
+struct RClevels {
+	uint8_t low[2][3];							// Shortest [MARK/SPACE][1, 2 or 3 intervals], in ticks
+	uint8_t high[2][3];							// Longest
+};
+
+#define RC_LEVELS(t1) { \
+	{{TICKS_LOW(t1 + MARK_EXCESS), TICKS_LOW(2*t1 + MARK_EXCESS), TICKS_LOW(3*t1 + MARK_EXCESS)}, \
+	 {TICKS_LOW(t1 - MARK_EXCESS), TICKS_LOW(2*t1 - MARK_EXCESS), TICKS_LOW(3*t1 - MARK_EXCESS)}}, \
+	{{TICKS_HIGH(t1 + MARK_EXCESS), TICKS_HIGH(2*t1 + MARK_EXCESS), TICKS_HIGH(3*t1 + MARK_EXCESS)}, \
+	 {TICKS_HIGH(t1 - MARK_EXCESS), TICKS_HIGH(2*t1 - MARK_EXCESS), TICKS_HIGH(3*t1 - MARK_EXCESS)}}}
+
+static const RClevels rc5Levels = RC_LEVELS(RC5_T1);
+static const RClevels rc6Levels = RC_LEVELS(RC6_T1);
+
+int LRreceiver::getRClevel(int *offset, int *used, const RClevels &levels) {
 	if (*offset >= rawlen) {
 		// After end of recorded buffer, assume SPACE.
 		return SPACE;
 	}
-	int width = rawbuf[*offset];
+	unsigned int width = rawTicks(*offset);
 	int val = ((*offset) % 2) ? MARK : SPACE;
-	int correction = (val == MARK) ? MARK_EXCESS : - MARK_EXCESS;
 
 	int avail;
-	if (MATCH(width, t1 + correction)) {
-		avail = 1;
-	} 
-	else if (MATCH(width, 2*t1 + correction)) {
-		avail = 2;
-	} 
-	else if (MATCH(width, 3*t1 + correction)) {
-		avail = 3;
+	for (avail = 0; avail < 3; avail++) {
+		if (matchTicks(width, levels.low[val][avail], levels.high[val][avail])) {
+			break;
+		}
 	}
-	else {
+	if (avail++ >= 3) {
 		return -1;
 	}
 
@@ -559,9 +1945,11 @@ int LRremote::getRClevel(int *offset, int *used, int t1) {
 #endif
 	return val;
 }
+#endif
 
+#if LR_DECODES(RC5)
 // RC5.
-bool LRremote::decodeRC5() {
+bool LRreceiver::decodeRC5() {
 	if (rawlen < MIN_RC5_SAMPLES + 2) {
 		return false;
 	}
@@ -569,13 +1957,13 @@ bool LRremote::decodeRC5() {
 	long data = 0;
 	int used = 0;
 	// Get start bits
-	if (getRClevel(&offset, &used, RC5_T1) != MARK) return false;
-	if (getRClevel(&offset, &used, RC5_T1) != SPACE) return false;
-	if (getRClevel(&offset, &used, RC5_T1) != MARK) return false;
+	if (getRClevel(&offset, &used, rc5Levels) != MARK) return false;
+	if (getRClevel(&offset, &used, rc5Levels) != SPACE) return false;
+	if (getRClevel(&offset, &used, rc5Levels) != MARK) return false;
 	int nbits;
 	for (nbits = 0; offset < rawlen; nbits++) {
-		int levelA = getRClevel(&offset, &used, RC5_T1); 
-		int levelB = getRClevel(&offset, &used, RC5_T1);
+		int levelA = getRClevel(&offset, &used, rc5Levels); 
+		int levelB = getRClevel(&offset, &used, rc5Levels);
 		if (levelA == SPACE && levelB == MARK) {
 			// 1 bit
 			data = (data << 1) | 1;
@@ -595,39 +1983,41 @@ bool LRremote::decodeRC5() {
 	decode_type = RC5;
 	return true;
 }
+#endif
 
+#if LR_DECODES(RC6)
 // RC6.
-bool LRremote::decodeRC6() {
+bool LRreceiver::decodeRC6() {
 	if (rawlen < MIN_RC6_SAMPLES) {
 		return false;
 	}
 	int offset = 1; // Skip first space
 	// Initial mark
-	if (!MATCH_MARK(rawbuf[offset], RC6_HDR_MARK)) {
+	if (!MATCH_MARK(rawTicks(offset), RC6_HDR_MARK)) {
 		return false;
 	}
 	offset++;
-	if (!MATCH_SPACE(rawbuf[offset], RC6_HDR_SPACE)) {
+	if (!MATCH_SPACE(rawTicks(offset), RC6_HDR_SPACE)) {
 		return false;
 	}
 	offset++;
 	long data = 0;
 	int used = 0;
 	// Get start bit (1)
-	if (getRClevel(&offset, &used, RC6_T1) != MARK) return false;
-	if (getRClevel(&offset, &used, RC6_T1) != SPACE) return false;
+	if (getRClevel(&offset, &used, rc6Levels) != MARK) return false;
+	if (getRClevel(&offset, &used, rc6Levels) != SPACE) return false;
 	int nbits;
 	for (nbits = 0; offset < rawlen; nbits++) {
 		int levelA, levelB; // Next two levels
-		levelA = getRClevel(&offset, &used, RC6_T1); 
+		levelA = getRClevel(&offset, &used, rc6Levels); 
 		if (nbits == 3) {
 			// T bit is double wide; make sure second half matches
-			if (levelA != getRClevel(&offset, &used, RC6_T1)) return false;
+			if (levelA != getRClevel(&offset, &used, rc6Levels)) return false;
 		} 
-		levelB = getRClevel(&offset, &used, RC6_T1);
+		levelB = getRClevel(&offset, &used, rc6Levels);
 		if (nbits == 3) {
 			// T bit is double wide; make sure second half matches
-			if (levelB != getRClevel(&offset, &used, RC6_T1)) return false;
+			if (levelB != getRClevel(&offset, &used, rc6Levels)) return false;
 		} 
 		if (levelA == MARK && levelB == SPACE) { // reversed compared to RC5
 			// 1 bit
@@ -647,189 +2037,162 @@ bool LRremote::decodeRC6() {
 	decode_type = RC6;
 	return true;
 }
+#endif
 
-// Panasonic
-bool LRremote::decodePanasonic() {
-	unsigned long long data = 0;
-	int offset = 1;
+#if LR_DECODES(LEARNED)
+/*
+ *
+ * Learned templates
+ *
+ * A remote none of the decoders knows can still be learned. learn() takes the next frame the receiver captures and 
+ * makeTemplate() boils it down to an LRtemplate: the handful of different durations its MARKs and SPACEs come in 
+ * (usually a header MARK and SPACE, a bit MARK and a SPACE or two), and for each entry which of them it is, in two
+ * bits. That's 29 bytes for a frame of up to 96 entries, and it can be saved in EEPROM and compared with frames 
+ * captured anywhere, where the hash of a frame can only be compared with another hash. 
+ *
+ * setTemplates() gives the receiver a table of them, and decodeLearned() compares each frame with it before the hash 
+ * is tried. A frame matches a template if it has the same number of entries and each is within TOLERANCE percent of
+ * its symbol's duration. The length weeds out almost every template at once, and the comparison of the rest stops 
+ * at the first entry that's out.
+ *
+ */
 
-	if (!MATCH_MARK(rawbuf[offset], PANASONIC_HDR_MARK)) {
-		return false;
-	}
-	offset++;
-	if (!MATCH_MARK(rawbuf[offset], PANASONIC_HDR_SPACE)) {
-		return false;
-	}
-	offset++;
+/*
+ * learn() -- Learn the next frame received into *tmpl, or, if tmpl is 0, stop waiting for one. The frame isn't 
+ * decoded. learning() says when it has been learned.
+ *
+ */
+void LRreceiver::learn(LRtemplate *tmpl) {
+	cli();													// decode() may be reading it in the ISR's bottom half
+	learnInto = tmpl;
+	sei();
+}
 
-	// decode address
-	for (int i = 0; i < PANASONIC_BITS; i++) {
-		if (!MATCH_MARK(rawbuf[offset++], PANASONIC_BIT_MARK)) {
-			return false;
-		}
-		if (MATCH_SPACE(rawbuf[offset],PANASONIC_ONE_SPACE)) {
-			data = (data << 1) | 1;
-		} else if (MATCH_SPACE(rawbuf[offset],PANASONIC_ZERO_SPACE)) {
-			data <<= 1;
-		} else {
-			return false;
-		}
-		offset++;
-	}
-	value = (unsigned long)data;
-	panasonicAddress = (unsigned int)(data >> 32);
-	decode_type = PANASONIC;
-	bits = PANASONIC_BITS;
-	return true;
+/*
+ * learning() -- Return true while learn() is still waiting for a frame it can make a template of. Frames with fewer 
+ * than 6 or more than TEMPLATE_ENTRIES MARKs and SPACEs, or more than TEMPLATE_SYMBOLS different durations, can't be 
+ * learned and are passed over.
+ *
+ */
+bool LRreceiver::learning() {
+	service();
+	cli();
+	bool waiting = learnInto != 0;
+	sei();
+	return waiting;
 }
 
-// LG.
-bool LRremote::decodeLG() {
-	long data = 0;
-	int offset = 1; // Skip first space
-  
-	// Initial mark
-	if (!MATCH_MARK(rawbuf[offset], LG_HDR_MARK)) {
-		return false;
-	}
-	offset++; 
-	if (rawlen < 2 * LG_BITS + 1 ) {
-		return false;
-	}
-	// Initial space 
-	if (!MATCH_SPACE(rawbuf[offset], LG_HDR_SPACE)) {
-		return false;
-	}
-	offset++;
-	for (int i = 0; i < LG_BITS; i++) {
-		if (!MATCH_MARK(rawbuf[offset], LG_BIT_MARK)) {
-			return false;
-		}
-		offset++;
-		if (MATCH_SPACE(rawbuf[offset], LG_ONE_SPACE)) {
-			data = (data << 1) | 1;
-		} 
-		else if (MATCH_SPACE(rawbuf[offset], LG_ZERO_SPACE)) {
-			data <<= 1;
-		} 
-		else {
-			return false;
-		}
-		offset++;
-	}
-	//Stop bit
-	if (!MATCH_MARK(rawbuf[offset], LG_BIT_MARK)){
-		return false;
-	}
-	// Success
-	bits = LG_BITS;
-	value = data;
-	decode_type = LG;
-	return true;
+/*
+ * setTemplates() -- Set the learned buttons decode() looks for. A frame matching templates[ix] decodes as LEARNED,
+ * with the value LEARNED_CODE(ix). templates[] has to stay put for as long as it's in use.
+ *
+ */
+void LRreceiver::setTemplates(const LRtemplate templates[], uint8_t count) {
+	cli();
+	this->templates = templates;
+	templateCount = count;
+	sei();
 }
 
-// JVC.
-bool LRremote::decodeJVC() {
-	long data = 0;
-	int offset = 1; // Skip first space
-	// Check for repeat
-	if (rawlen - 1 == 33 &&
-		MATCH_MARK(rawbuf[offset], JVC_BIT_MARK) &&
-		MATCH_MARK(rawbuf[rawlen-1], JVC_BIT_MARK)) {
-		bits = 0;
-		value = REPEAT;
-		decode_type = JVC;
-		return true;
-	} 
-	// Initial mark
-	if (!MATCH_MARK(rawbuf[offset], JVC_HDR_MARK)) {
-		return false;
-	}
-	offset++; 
-	if (rawlen < 2 * JVC_BITS + 1 ) {
-		return false;
-	}
-	// Initial space 
-	if (!MATCH_SPACE(rawbuf[offset], JVC_HDR_SPACE)) {
+/*
+ * templateLow(), templateHigh() -- The range of ticks a duration of ticks may be measured as, within TOLERANCE percent.
+ *
+ */
+static inline unsigned int templateLow(unsigned int ticks) {
+	return ticks - ticks * TOLERANCE / 100;
+}
+
+static inline unsigned int templateHigh(unsigned int ticks) {
+	return ticks + ticks * TOLERANCE / 100 + 1;
+}
+
+/*
+ * makeTemplate() -- Make a template of the frame in rawbuf. Returns false, leaving tmpl alone, if it can't.
+ *
+ * Each entry is taken to be the first symbol so far whose duration (the average of the entries assigned it) it's 
+ * within tolerance of, or else a new one. Entries of 255 ticks or more are all the same symbol, 255.
+ *
+ */
+bool LRreceiver::makeTemplate(LRtemplate &tmpl) {
+	unsigned int length = rawlen - 1;						// The gap before the frame isn't part of it
+	if (length < 6 || length > TEMPLATE_ENTRIES) {
 		return false;
 	}
-	offset++;
-	for (int i = 0; i < JVC_BITS; i++) {
-		if (!MATCH_MARK(rawbuf[offset], JVC_BIT_MARK)) {
-			return false;
+	LRtemplate made;
+	unsigned int sum[TEMPLATE_SYMBOLS];						// Total ticks and count of the entries of each symbol
+	uint8_t count[TEMPLATE_SYMBOLS];
+	uint8_t symbolCount = 0;
+	memset(&made, 0, sizeof(made));
+	for (unsigned int i = 0; i < length; i++) {
+		unsigned int ticks = rawTicks(i + 1);
+		if (ticks > 255) {
+			ticks = 255;
 		}
-		offset++;
-		if (MATCH_SPACE(rawbuf[offset], JVC_ONE_SPACE)) {
-			data = (data << 1) | 1;
-		} 
-		else if (MATCH_SPACE(rawbuf[offset], JVC_ZERO_SPACE)) {
-			data <<= 1;
-		} 
-		else {
-			return false;
+		uint8_t symbol;
+		for (symbol = 0; symbol < symbolCount; symbol++) {
+			unsigned int average = sum[symbol] / count[symbol];
+			if (ticks >= templateLow(average) && ticks <= templateHigh(average)) {
+				break;
+			}
 		}
-		offset++;
+		if (symbol == symbolCount) {						// If it's none of the ones so far
+			if (symbolCount == TEMPLATE_SYMBOLS) {			//   And there's no room for another
+				return false;
+			}
+			sum[symbol] = count[symbol] = 0;
+			symbolCount++;
+		}
+		sum[symbol] += ticks;
+		count[symbol]++;
+		made.symbols[i >> 2] |= symbol << ((i & 3) << 1);
 	}
-	//Stop bit
-	if (!MATCH_MARK(rawbuf[offset], JVC_BIT_MARK)){
-		return false;
+	for (uint8_t symbol = 0; symbol < symbolCount; symbol++) {
+		made.ticks[symbol] = (sum[symbol] + count[symbol] / 2) / count[symbol];
 	}
-	// Success
-	bits = JVC_BITS;
-	value = data;
-	decode_type = JVC;
+	made.length = length;
+	tmpl = made;
 	return true;
 }
 
-// SAMSUNG.
-bool LRremote::decodeSAMSUNG() {
-	long data = 0;
-	int offset = 1; // Skip first space
-	// Initial mark
-	if (!MATCH_MARK(rawbuf[offset], SAMSUNG_HDR_MARK)) {
-		return false;
-	}
-	offset++;
-	// Check for repeat
-	if (rawlen == 4 &&									// SAMSUNGs have a repeat only 4 items long
-		MATCH_SPACE(rawbuf[offset], SAMSUNG_RPT_SPACE) &&
-		MATCH_MARK(rawbuf[offset+1], SAMSUNG_BIT_MARK)) {
-		bits = 0;
-		value = REPEAT;
-		decode_type = SAMSUNG;
-		return true;
-	}
-	if (rawlen < 2 * SAMSUNG_BITS + 4) {
-		return false;
-	}
-	// Initial space
-	if (!MATCH_SPACE(rawbuf[offset], SAMSUNG_HDR_SPACE)) {
-		return false;
-	}
-	offset++;
-	for (int i = 0; i < SAMSUNG_BITS; i++) {
-		if (!MATCH_MARK(rawbuf[offset], SAMSUNG_BIT_MARK)) {
-			return false;
+/*
+ * decodeLearned() -- Decode the frame in rawbuf as the first of templates[] it matches, if any.
+ *
+ */
+bool LRreceiver::decodeLearned() {
+	unsigned int length = rawlen - 1;
+	for (uint8_t ix = 0; ix < templateCount; ix++) {
+		const LRtemplate &tmpl = templates[ix];
+		if (tmpl.length != length) {						// Most templates go here
+			continue;
 		}
-		offset++;
-		if (MATCH_SPACE(rawbuf[offset], SAMSUNG_ONE_SPACE)) {
-			data = (data << 1) | 1;
-		} 
-		else if (MATCH_SPACE(rawbuf[offset], SAMSUNG_ZERO_SPACE)) {
-			data <<= 1;
-		} 
-		else {
-			return false;
+		unsigned int low[TEMPLATE_SYMBOLS];
+		unsigned int high[TEMPLATE_SYMBOLS];
+		for (uint8_t symbol = 0; symbol < TEMPLATE_SYMBOLS; symbol++) {
+			low[symbol] = templateLow(tmpl.ticks[symbol]);
+			high[symbol] = tmpl.ticks[symbol] == 255 ? 0xFFFF : templateHigh(tmpl.ticks[symbol]);
+		}
+		unsigned int i;
+		for (i = 0; i < length; i++) {
+			uint8_t symbol = (tmpl.symbols[i >> 2] >> ((i & 3) << 1)) & 3;
+			unsigned int ticks = rawTicks(i + 1);
+			LR_COUNT(matches);
+			if (ticks < low[symbol] || ticks > high[symbol]) {
+				break;
+			}
+		}
+		if (i == length) {
+			decode_type = LEARNED;
+			value = LEARNED_CODE(ix);
+			bits = 32;
+			panasonicAddress = 0;
+			return true;
 		}
-		offset++;
 	}
-	// Success
-	bits = SAMSUNG_BITS;
-	value = data;
-	decode_type = SAMSUNG;
-	return true;
+	return false;
 }
+#endif
 
+#if LR_DECODES(UNKNOWN)
 /* -----------------------------------------------------------------------
  * hashdecode - decode an arbitrary IR code.
  * Instead of decoding using a standard encoding scheme
@@ -846,12 +2209,13 @@ bool LRremote::decodeSAMSUNG() {
 
 // Compare two tick values, returning 0 if newval is shorter,
 // 1 if newval is equal, and 2 if newval is longer
-// Use a tolerance of 20%
-int LRremote::compare(unsigned int oldval, unsigned int newval) {
-	if (newval < oldval * .8) {
+// Use a tolerance of 20% (x < 0.8 * y  is  5 * x < 4 * y)
+int LRreceiver::compare(unsigned int oldval, unsigned int newval) {
+	LR_COUNT(hashSteps);
+	if (5UL * newval < 4UL * oldval) {
 		return 0;
 	} 
-	else if (oldval < newval * .8) {
+	else if (5UL * oldval < 4UL * newval) {
 		return 2;
 	} 
 	else {
@@ -862,16 +2226,22 @@ int LRremote::compare(unsigned int oldval, unsigned int newval) {
 // Use FNV hash algorithm: http://isthe.com/chongo/tech/comp/fnv/#FNV-param
 #define FNV_PRIME_32 16777619
 #define FNV_BASIS_32 2166136261
+#define FNV_PRIME_64 1099511628211ULL
+#define FNV_BASIS_64 14695981039346656037ULL
 
 /* Converts the raw code values into a 32-bit hash code.
  * Hopefully this code is unique for each button.
  * This isn't a "real" decoding, just an arbitrary value.
+ *
+ * With HASH_64 it's a 64-bit FNV-1a hash instead, which mixes each value in before multiplying rather than after, 
+ * split between value and hashHigh. A 64-bit multiply costs an AVR several times what a 32-bit one does, so it's 
+ * only for sketches that need the extra bits to tell their buttons apart.
  */
-bool LRremote::decodeHash() {
+bool LRreceiver::decodeHash() {
 #ifdef DEBUG
 	Serial.print("decodeHash - rawbuf: ");
 	for (int i = 0; i <= rawlen; i++) {
-		Serial.print(rawbuf[i]);
+		Serial.print(rawTicks(i));
 		if (i < rawlen) Serial.print(", ");
 	}
 	Serial.println(".");
@@ -880,17 +2250,55 @@ bool LRremote::decodeHash() {
 	if (rawlen < 6) {
 		return false;
 	}
-	long hash = FNV_BASIS_32;
+#ifdef HASH_64
+	uint64_t hash = FNV_BASIS_64;
+	for (int i = 1; i+2 < rawlen; i++) {
+		int value =	compare(rawTicks(i), rawTicks(i+2));
+		// Add value into the hash
+		hash = (hash ^ value) * FNV_PRIME_64;
+	}
+	value = (unsigned long)hash;
+	hashHigh = (unsigned long)(hash >> 32);
+	bits = 64;
+#else
+	uint32_t hash = FNV_BASIS_32;
 	for (int i = 1; i+2 < rawlen; i++) {
-		int value =	compare(rawbuf[i], rawbuf[i+2]);
+		int value =	compare(rawTicks(i), rawTicks(i+2));
 		// Add value into the hash
 		hash = (hash * FNV_PRIME_32) ^ value;
 	}
 	value = hash;
 	bits = 32;
+#endif
 	decode_type = UNKNOWN;
 	return true;
 }
+#endif
+
+/*
+ * eventCode() -- The code keymaps and binding tables list event's button under: its value, and with HASH_64 an 
+ * UNKNOWN's hashHigh above that.
+ *
+ */
+static LRcode eventCode(const LRevent &event) {
+#ifdef HASH_64
+	return (LRcode)event.hashHigh << 32 | (uint32_t)event.value;
+#else
+	return event.value;
+#endif
+}
+
+/*
+ * bindingCode() -- The code of the PROGMEM binding, as eventCode() would have it.
+ *
+ */
+static LRcode bindingCode(const LRbinding *binding) {
+#ifdef HASH_64
+	return (LRcode)pgm_read_dword(&binding->codeHigh) << 32 | pgm_read_dword(&binding->code);
+#else
+	return pgm_read_dword(&binding->code);
+#endif
+}
 
 /*
  *
@@ -902,10 +2310,13 @@ bool LRremote::decodeHash() {
  *   match it calls corresponding function from the passed array of functions and returns true. It handles the 
  *   case of receiving an IR code that wasn't matched by returning false.
  *
- *   On NEC remotes, holding down a button generates one instance of the button code followed by the code for 
- *   "repeat" over and over. This is handled by behaving as though the button had been pressed repeatedly, but 
- *   only after the button has been held down for a bit. The delay is to avoid unintended repeats. This behavior
- *   may be overridden by including a button function for the repeat code.
+ *   Holding down a button makes the remote send frames over and over: the button code again (Sony, RC5, ...) or the
+ *   code for "repeat" (NEC, Samsung). This is handled by behaving as though the button had been pressed repeatedly, 
+ *   but only after the button has been held down for a bit, and at a pace set by the clock rather than by the frames.
+ *   See keyAction(). The NEC behavior may be overridden by including a button function for the repeat code.
+ *
+ *   With HASH_64, code[] has only the low 32 bits of an UNKNOWN's hash, and that's all that's compared. Use a keymap
+ *   or a binding table to tell such buttons apart by the whole hash.
  *
  *   Parameters:
  *     int code[]			An array listing the IR codes that are of interest.
@@ -914,44 +2325,267 @@ bool LRremote::decodeHash() {
  *     long codeCount		The number of entries present in the code[] and fButton[] arrays
  */
 
-bool LRremote::onButton(long code[], void (*fButton[])(), int codeCount) {
+bool LRreceiver::onButton(long code[], void (*fButton[])(), int codeCount) {
 	int keyIx;												// Index for code[] and fButton[]
-	if (decode()) {											// If an IR code was received
+	LRevent event;
+	bool received = read(event);							// Whether an IR code was received
+	LRcode key;												// The code of the button to act on, if any
+	if (received && event.value == REPEAT) {				// If it's a REPEAT with a button function of its own
 		for (keyIx = 0; keyIx < codeCount; keyIx++) {
-			if (value == code[keyIx]) {						//   If it's a code of interest
-				repeat = 0;									//     Reset repeat count
-				lastValue = value;							//     Remember value for possible future REPEAT processing
-				break;
+			if ((unsigned long)code[keyIx] == REPEAT) {
+				dispatched(event);
+				fButton[keyIx]();							//   Leave it to that
+				return true;
 			}
-		}													//   Here keyIX = index of received code; codeCount if no match
-		if (keyIx >= codeCount && value == REPEAT) {		//   If code is a REPEAT not matched by a button function
-			if (++repeat < REPEAT_PAUSE) {					//     Force user to hold down the same key for more than a
-				resume();									//     fraction of a second by ignoring the first few repeat
-				return false;								//     codes
-			}
-			for (keyIx = 0; keyIx < codeCount; keyIx++) {	//     redo keyIx for lastValue
-				if (lastValue == code[keyIx]) {
+		}
+	}
+	if (keyAction(received ? &event : 0, key)) {			// If a button is to act now
+		keyIx = lastIx;										//   Try where we found it last time, then look it up
+		if (keyIx >= codeCount || (uint32_t)code[keyIx] != (uint32_t)key) {
+			for (keyIx = 0; keyIx < codeCount; keyIx++) {
+				if ((uint32_t)code[keyIx] == (uint32_t)key) {
 					break;
 				}
 			}
-		}
-		if (keyIx < codeCount) {							//   If we found a code of interest
+		}													//   Here keyIX = index of the code; codeCount if no match
+		if (keyIx < codeCount) {							//   If it's a code of interest
+			lastIx = keyIx;									//     Remember where we found it
+			if (received) {
+				dispatched(event);
+			}
 			fButton[keyIx]();								//     Do whatever it is we're s'posed to do
-			resume();										//     Start looking for codes again
 			return true;									//     Say we processed a code
 		}
-															//   If we get here we received a code but aren't going to
-															//   handle it.
+	}
+	if (received) {											// If we get here we received a code but aren't going to
+															// handle it.
 		#ifdef DEBUG
 		Serial.println("onButton: IR Code not recognized.");
 		Serial.print("decode_type: 0x");
-		Serial.print(decode_type, HEX);
+		Serial.print(event.decode_type, HEX);
 		Serial.print(", value: 0x");
-		Serial.print(value, HEX);
+		Serial.print(event.value, HEX);
 		Serial.print(", bits: ");
-		Serial.println(bits);
+		Serial.println(event.bits);
 #endif
-		resume();											//   Resume looking for new IR codes
 	}
 	return false;											// Say we didn't do anything.
+}
+
+/*
+ *
+ *   The keymap version of onButton.
+ *
+ *   Behaves just like the parallel array version but looks the code up with a binary search, so it's the one to use
+ *   for big keymaps. A 128-key keymap takes at most 8 comparisons rather than up to 128. To make that possible, 
+ *   keymap[] must be sorted by code. Either list it in that order or pass it to sortKeys() once, in setup().
+ *
+ *   Parameters:
+ *     LRkey keymap[]		The codes of interest and the button function to invoke for each, sorted by code
+ *     int keyCount			The number of entries in keymap[]
+ */
+
+bool LRreceiver::onButton(const LRkey keymap[], int keyCount) {
+	LRevent event;
+	bool received = read(event);							// Whether an IR code was received
+	int keyIx;
+	if (received && event.value == REPEAT && (keyIx = findKey(keymap, keyCount, REPEAT)) < keyCount) {
+		dispatched(event);									// A REPEAT with a button function of its own
+		keymap[keyIx].fButton();
+		return true;
+	}
+	LRcode key;
+	if (!keyAction(received ? &event : 0, key)) {			// If no button is to act now
+		return false;										//   Nothing to do
+	}
+	keyIx = lastIx;											// Try where we found it last time, then look it up
+	if (keyIx >= keyCount || keymap[keyIx].code != key) {
+		keyIx = findKey(keymap, keyCount, key);
+	}
+	if (keyIx < keyCount) {									// If it's a code of interest
+		lastIx = keyIx;										//   Remember where we found it
+		if (received) {
+			dispatched(event);
+		}
+		keymap[keyIx].fButton();							//   Do whatever it is we're s'posed to do
+		return true;										//   Say we processed a code
+	}
+	return false;											// Received a code but aren't going to handle it
+}
+
+/*
+ * findKey() -- Binary search keymap[] for code. Returns its index (the first, if it's there more than once) or 
+ * keyCount if it's not there.
+ *
+ */
+int LRreceiver::findKey(const LRkey keymap[], int keyCount, LRcode code) {
+	int low = 0;
+	int high = keyCount;
+	while (low < high) {									// Invariant: code isn't before low or at/after high
+		int mid = (unsigned int)(low + high) >> 1;
+		if (keymap[mid].code < code) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return (low < keyCount && keymap[low].code == code) ? low : keyCount;
+}
+
+/*
+ *
+ *   The binding table version of onButton.
+ *
+ *   Behaves just like the keymap version, but the table is in flash (PROGMEM) rather than RAM, and each entry carries 
+ *   a context pointer for its handler. One handler can then serve many buttons -- a digit handler passed &digits[7], 
+ *   say, or a device's handler passed the device -- where the other versions need a function per button. Since the 
+ *   table can't be sorted in place, list it in order of code.
+ *
+ *   Parameters:
+ *     LRbinding bindings[]	The codes of interest, each with the handler to invoke and its ctx, sorted by code
+ *     int bindingCount		The number of entries in bindings[]
+ */
+
+bool LRreceiver::onButton_P(const LRbinding bindings[], int bindingCount) {
+	LRevent event;
+	bool received = read(event);							// Whether an IR code was received
+	int ix = bindingCount;
+	if (received && event.value == REPEAT) {				// A REPEAT with a handler of its own?
+		ix = findBinding(bindings, bindingCount, REPEAT);
+	}
+	LRcode key;
+	if (ix >= bindingCount) {								// If not, ask the repeat engine
+		if (!keyAction(received ? &event : 0, key)) {		//   If no button is to act now
+			return false;									//     Nothing to do
+		}
+		ix = lastIx;										//   Try where we found it last time, then look it up
+		if (ix >= bindingCount || bindingCode(&bindings[ix]) != key) {
+			ix = findBinding(bindings, bindingCount, key);
+		}
+		if (ix < bindingCount) {
+			lastIx = ix;									//   Remember where we found it
+		}
+	}
+	if (ix < bindingCount) {								// If we found a code of interest
+		LRbinding binding;
+		memcpy_P(&binding, &bindings[ix], sizeof(binding));	//   Fetch its handler and ctx from flash
+		if (received) {
+			dispatched(event);
+		}
+		binding.handler(binding.ctx);						//   And do whatever it is we're s'posed to do
+		return true;										//   Say we processed a code
+	}
+	return false;											// Received a code but aren't going to handle it
+}
+
+/*
+ * findBinding() -- Binary search the PROGMEM bindings[] for code. Returns its index (the first, if it's there more 
+ * than once) or bindingCount if it's not there.
+ *
+ */
+int LRreceiver::findBinding(const LRbinding bindings[], int bindingCount, LRcode code) {
+	int low = 0;
+	int high = bindingCount;
+	while (low < high) {									// Invariant: code isn't before low or at/after high
+		int mid = (unsigned int)(low + high) >> 1;
+		if (bindingCode(&bindings[mid]) < code) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return (low < bindingCount && bindingCode(&bindings[low]) == code) ? low : bindingCount;
+}
+
+/*
+ *
+ * The repeat engine
+ *
+ * keyAction() decides, for onButton(), whether a button is to act now and if so which. event is the transmission 
+ * read() just returned, or 0 if there wasn't one. If a button is to act, it returns true with code set to its code.
+ *
+ * A frame that isn't the button being held (lastValue) is a new press, and the button acts at once. A frame that is 
+ * -- a REPEAT, or lastValue again, within REPEAT_HOLD of the last one -- only keeps the button held down. While it 
+ * is, the button acts again repeatDelay after the press, then every repeatGap, which starts at repeatRate and 
+ * shrinks by repeatAccel/256 each time down to repeatFastest. All of that is timed by the frames' timestamps and 
+ * micros(), not by counting frames, so the pace is the same whatever the protocol's repeat period, and a repeat 
+ * that falls due between frames happens on the next call rather than waiting for the next frame. Between frames, the
+ * button counts as held until a quarter of a repeat period after the next frame was due. Any later than that, only 
+ * another frame says it still is.
+ *
+ */
+bool LRreceiver::keyAction(const LRevent *event, LRcode &code) {
+	unsigned long now;
+	if (event) {											// If there's a frame
+		now = event->time;
+		if (!holding || now - lastFrame > REPEAT_HOLD * 1000UL || 
+				(event->value != REPEAT && eventCode(*event) != lastValue)) {
+			if (event->value == REPEAT) {					//   A REPEAT of nothing we know about
+				holding = false;
+				return false;
+			}
+			holding = true;									//   It's a new press
+			lastValue = eventCode(*event);
+			lastFrame = now;
+			framePeriod = 0;
+			nextRepeat = now + repeatDelay * 1000UL;
+			repeatGap = repeatRate * 1000UL;
+			code = lastValue;
+			return true;
+		}
+		framePeriod = now - lastFrame;						//   The button's still held
+		lastFrame = now;
+	} else {												// No frame; is the button still held?
+		if (!holding || framePeriod == 0) {					//   (Until there's a period to go by, only a frame says so)
+			return false;
+		}
+		now = micros();
+		if (now - lastFrame > framePeriod + framePeriod / 4) {
+			return false;									//   Not as far as we know. (If it is, a frame will say so.)
+		}
+	}
+	if ((long)(now - nextRepeat) < 0) {						// Not time yet
+		return false;
+	}
+	nextRepeat += repeatGap;								// Time to repeat; when's the next one?
+	if ((long)(nextRepeat - now) <= 0) {					//   (Not in a burst, if we've fallen behind)
+		nextRepeat = now + repeatGap;
+	}
+	repeatGap -= (repeatGap * repeatAccel) >> 8;
+	if (repeatGap < repeatFastest * 1000UL) {
+		repeatGap = repeatFastest * 1000UL;
+	}
+	code = lastValue;
+	return true;
+}
+
+/*
+ * setRepeat() -- Set how onButton() repeats a held button: it waits delayMs after the press, then repeats rateMs 
+ * apart, each repeat coming accel/256 sooner than the last, until they're fastestMs apart. An accel of 0 repeats 
+ * at a steady rateMs. The defaults are REPEAT_DELAY, REPEAT_RATE, REPEAT_FASTEST and REPEAT_ACCEL.
+ *
+ */
+void LRreceiver::setRepeat(unsigned int delayMs, unsigned int rateMs, unsigned int fastestMs, uint8_t accel) {
+	repeatDelay = delayMs;
+	repeatRate = rateMs;
+	repeatFastest = fastestMs;
+	repeatAccel = accel;
+}
+
+/*
+ * sortKeys() -- Sort keymap[] by code so that it can be used with onButton().
+ *
+ * An insertion sort: small, and it's only done once, in setup(). It keeps keys with the same code in the order they
+ * were listed, so of those the first listed is the one onButton() calls.
+ *
+ */
+void LRreceiver::sortKeys(LRkey keymap[], int keyCount) {
+	for (int i = 1; i < keyCount; i++) {
+		LRkey key = keymap[i];
+		int j;
+		for (j = i; j > 0 && keymap[j - 1].code > key.code; j--) {
+			keymap[j] = keymap[j - 1];
+		}
+		keymap[j] = key;
+	}
 }
\ No newline at end of file
@@ -12,10 +12,48 @@
 #ifndef LRremote_h
 #define LRremote_h
 
+#include <stdint.h>
+
 // The following are compile-time library options.
 // If you change them, recompile the library.
 // If DEBUG is defined, a lot of debugging output will be printed during decoding.
 // #define DEBUG
+// If STREAM_DECODE is defined, the ISR decodes NEC, Panasonic, LG, JVC and Samsung frames bit by bit as they arrive
+// so they're ready the moment the last bit is in. Comment it out to save the flash and RAM that takes. (Or define
+// LR_NO_STREAM_DECODE in the build flags, which the host build does to replay the captures through the batch decoders.)
+#define STREAM_DECODE
+// If COMPACT_RAWBUF is defined, the raw buffer holds each duration in a byte rather than two, which halves the RAM it
+// takes. Comment it out to trade the RAM for a little less work per entry. (An LRremoteBuf can choose for itself.)
+#define COMPACT_RAWBUF
+// If ISR_BOTTOM_HALF is defined, each frame is decoded as soon as it's complete, by the bottom half of the ISR that 
+// finished it (with interrupts enabled again), and queued for read(). Comment it out to decode only when the sketch 
+// calls read() or onButton().
+#define ISR_BOTTOM_HALF
+// If LATENCY_STATS is defined, the start, end and decode times of each frame are kept, and a histogram of how long 
+// frames take from start to capture, decode and dispatch can be printed with printLatency(). Off by default: it costs
+// RAM, flash and a few micros() calls per frame.
+// #define LATENCY_STATS
+// If DECODE_STATS is defined, the library counts what becomes of the frames it captures -- decoded, by protocol, or 
+// lost, and where -- for getStats(). Off by default: it costs 64 bytes of RAM and an increment here and there.
+// #define DECODE_STATS
+// If CALIBRATE_EXCESS is defined, calibrate() has a receiver measure how much its module stretches MARKs (and shrinks
+// SPACEs) from the frames it decodes and correct for it as it captures, in place of the fixed MARK_EXCESS. Off by 
+// default: it costs 70 bytes of RAM per receiver and an add per MARK or SPACE.
+// #define CALIBRATE_EXCESS
+// If HASH_64 is defined, frames no decoder knows are hashed with 64-bit FNV-1a rather than 32-bit FNV-1: value has
+// the low 32 bits and hashHigh the high 32. Keymaps and binding tables then list codes as an LRcode, 64 bits, with an
+// UNKNOWN's hashHigh on top, so buttons are told apart by the whole hash. Off by default, because it changes every 
+// UNKNOWN code a sketch already has in its keymaps. extras/host/LRhash counts the collisions.
+// #define HASH_64
+// If VALIDATE_FRAMES is defined, NEC and Samsung frames must carry a command byte and its complement, and a Samsung 
+// frame the same address byte twice, or they're dropped as noise rather than decoded. With setAddress(), the 16-bit
+// address (extended NEC's too) must be the one given. A bad address stops the decoder half way through the frame.
+// Off by default: the odd remote that doesn't follow the rules would stop working.
+// #define VALIDATE_FRAMES
+// If IR_SEND is defined, LRsender sends frames through an IR LED on the timer's PWM pin (TIMER_PWM_PIN in 
+// LRremoteInt.h, pin 3 on an Uno): the timer makes the carrier and its interrupt steps through the MARKs and SPACEs.
+// Off by default. The CAPTURE_POLL receivers don't sample while a frame goes out.
+// #define IR_SEND
 
 // Values for decode_type
 #define NEC 1
@@ -30,52 +68,371 @@
 #define MITSUBISHI 10
 #define SAMSUNG 11
 #define LG 12
+#define LEARNED 13			// Matched a learned template (see learn())
 #define UNKNOWN -1
 
+// Bit representing a decode_type in a set of decoders. UNKNOWN (the hash of anything else) is bit 0.
+#define PROTOCOL_BIT(type) ((type) < 0 ? 1U : 1U << (type))
+
+// The protocols to decode, another compile-time option. The decoders for the others aren't compiled in at all, so
+// they take no flash and no time. E.g., for a build that only ever sees NEC and Samsung remotes:
+// #define LR_PROTOCOLS (PROTOCOL_BIT(NEC) | PROTOCOL_BIT(SAMSUNG))
+// extras/host/sizes.sh reports the library's size for a range of choices. Set it here, or in the build flags so that
+// every file is compiled with it -- not in the sketch before #include "LRremote.h". It changes the LRremote class, so
+// the sketch and the library would disagree about its layout and which decoders it has (an ODR violation).
+#ifndef LR_PROTOCOLS
+#define LR_PROTOCOLS (PROTOCOL_BIT(NEC) | PROTOCOL_BIT(SONY) | PROTOCOL_BIT(SANYO) | PROTOCOL_BIT(MITSUBISHI) | \
+	PROTOCOL_BIT(RC5) | PROTOCOL_BIT(RC6) | PROTOCOL_BIT(PANASONIC) | PROTOCOL_BIT(LG) | PROTOCOL_BIT(JVC) | \
+	PROTOCOL_BIT(SAMSUNG) | PROTOCOL_BIT(LEARNED) | PROTOCOL_BIT(UNKNOWN))
+#endif
+#define LR_DECODES(type) ((LR_PROTOCOLS & PROTOCOL_BIT(type)) != 0)
+
+// Nothing to stream without any of the protocols the streaming decoders know, or if the build flags say not to
+#if !(LR_DECODES(NEC) || LR_DECODES(PANASONIC) || LR_DECODES(LG) || LR_DECODES(JVC) || LR_DECODES(SAMSUNG)) || \
+	defined(LR_NO_STREAM_DECODE)
+#undef STREAM_DECODE
+#endif
+
 // Some useful constants
 
-#define RAWBUF 100			// Length of raw duration buffer
+#define RAWBUF 100			// Length of raw duration buffer, unless an LRremoteBuf says otherwise
+#define RAWFRAMES 2			// Number of transmissions the raw buffer can hold (a power of two)
 #define REPEAT 0xffffffff	// Decoded value for NEC when a repeat code is received
-#define REPEAT_PAUSE (3)	// Number of repeat codes to ignore before deciding the user means it
+#define REPEAT_DELAY 500	// ms a button must be held down before onButton() starts repeating it
+#define REPEAT_RATE 200		// ms between the first repeats
+#define REPEAT_FASTEST 50	// ms between repeats once they've sped up all they will
+#define REPEAT_ACCEL 32		// How much each repeat shortens the time to the next, in 256ths
+#define REPEAT_HOLD 160		// Longest ms between the frames of a held button (longer than any remote's repeat period)
+#define MAX_RECEIVERS 4		// Most LRremote objects that can be enabled at once
+#define EVENT_QUEUE 4		// Decoded transmissions each receiver holds for read() (a power of two)
+#define TEMPLATE_ENTRIES 96	// Most MARKs and SPACEs a learned template can hold
+#define TEMPLATE_SYMBOLS 4	// Most different durations it can use (each entry is 2 bits)
+#define LEARNED_CODE(ix) (0x4C520000UL + (ix))	// Decoded value of a frame that matches templates[ix]
+
+// One duration in the raw buffer, in ticks, unless an LRremoteBuf says otherwise. The largest value an entry can hold
+// marks one too long to store; see record() in LRremote.cpp.
+#ifdef COMPACT_RAWBUF
+typedef uint8_t LRraw;
+#else
+typedef uint16_t LRraw;
+#endif
 
 // Marks tend to be 100us too long, and spaces 100us too short
-// when received due to sensor lag.
+// when received due to sensor lag. (With CALIBRATE_EXCESS, calibrate() measures the real figure.)
 #define MARK_EXCESS 100
+#define CALIBRATE_BUCKETS 16	// Buckets in each calibration histogram
+#define CALIBRATE_MIN -100		// The excess (us) at the bottom of the first; anything less counts there
+#define CALIBRATE_STEP 25		// us per bucket; anything past the last counts there
+#define CALIBRATE_WINDOW 512	// Samples a histogram holds before it halves, so old frames fade away
+#define CALIBRATE_SAMPLES 64	// Samples of each it takes before calibrate() corrects anything
+
+// Values for the capture mode passed to enable()
+#define CAPTURE_POLL 0		// Sample the receiver every 50us from the timer interrupt
+#define CAPTURE_EDGE 1		// Timestamp each receiver transition from an external interrupt
 
-// main class for receiving IR
-class LRremote
+// A button's code as keymaps and binding tables list it: the decoded value, with HASH_64 an UNKNOWN's hashHigh above it
+#ifdef HASH_64
+typedef uint64_t LRcode;
+#else
+typedef unsigned long LRcode;
+#endif
+
+// One entry of a keymap: a button code and the function to invoke when it's received
+struct LRkey {
+	LRcode code;
+	void (*fButton)();
+};
+
+// One entry of a binding table: a button code, the function to invoke when it's received and what to pass it. Binding
+// tables live in flash (PROGMEM).
+struct LRbinding {
+	uint32_t code;
+	void (*handler)(void *ctx);
+	void *ctx;
+#ifdef HASH_64
+	uint32_t codeHigh;								// UNKNOWN: the high 32 bits of the hash; 0 for the rest
+#endif
+};
+
+// A learned button: one frame, each of its MARKs and SPACEs quantized to one of at most TEMPLATE_SYMBOLS durations.
+// Bytes only and a fixed size, so it can go in EEPROM as it is (EEPROM.put()) and come back the same way. Erased 
+// EEPROM reads as a length of 255, which isn't a template.
+struct LRtemplate {
+	uint8_t length;									// Entries in the frame, 6 to TEMPLATE_ENTRIES; else not a template
+	uint8_t ticks[TEMPLATE_SYMBOLS];				// Duration of each symbol, in ticks
+	uint8_t symbols[(TEMPLATE_ENTRIES + 3) / 4];	// The entries' symbols, four to a byte, low bits first
+};
+
+// What a transmission decoded to, as poll() returns it; decode_type 0 if nothing
+struct DecodeResult {
+	int8_t decode_type;								// NEC, SONY, RC5, etc.
+	uint8_t bits;									// Number of bits in value
+	unsigned long value;							// Decoded value
+	unsigned int address;							// Panasonic address
+#ifdef HASH_64
+	unsigned long hashHigh;							// UNKNOWN: the high 32 bits of the hash
+#endif
+};
+
+// A decoded transmission and when it arrived, as read() returns it
+struct LRevent : DecodeResult {
+	unsigned long time;								// micros() when the receiver finished recording it
+#ifdef LATENCY_STATS
+	unsigned long start;							// micros() when it started
+	unsigned long decoded;							// micros() when it was decoded
+#endif
+};
+
+#ifdef LATENCY_STATS
+// Latency histograms. Bucket 0 counts latencies under 64us, bucket i those under 64us << i, and the last bucket the 
+// rest (262ms or more).
+#define LATENCY_BUCKETS 14
+class Print;										// Where printLatency() prints to (Arduino's Print.h)
+struct LRlatency {
+	uint16_t capture[LATENCY_BUCKETS];				// Start of a frame to the end of its capture
+	uint16_t decode[LATENCY_BUCKETS];				// End of capture to decoded and queued
+	uint16_t dispatch[LATENCY_BUCKETS];				// Queued to acted on (see dispatched())
+	uint16_t total[LATENCY_BUCKETS];				// Start of a frame to acted on
+};
+#endif
+
+// Number of rows in the pulse distance protocols' table (LRremote.cpp). NEC and Samsung repeats have rows of their own.
+#define PULSE_PROTOCOLS (2 * LR_DECODES(NEC) + LR_DECODES(PANASONIC) + LR_DECODES(LG) + LR_DECODES(JVC) + \
+	2 * LR_DECODES(SAMSUNG))
+
+#ifdef DECODE_STATS
+// What became of the frames captured since the counts were last reset, for all receivers. The counts wrap at 65536.
+struct LRstats {
+	uint16_t frames;								// Frames captured
+	uint16_t truncated;								// Of those, frames cut short because they filled the slot
+	uint16_t overruns;								// Transmissions missed because every frame slot was full
+	uint16_t queueDrops;							// Transmissions decoded but lost because the event queue was full
+	uint16_t noise;									// Frames too short to be anything (under 6 entries)
+	uint16_t unrecognized;							// Frames no decoder claimed (only if UNKNOWN isn't decoded)
+	uint16_t invalid;								// Frames dropped for failing VALIDATE_FRAMES' checks
+	uint16_t decoded[LEARNED + 1];					// Transmissions decoded, by decode_type (UNKNOWN in [0])
+	uint16_t rejected[LEARNED + 1];					// Frames a decoder was tried on and didn't match, by decode_type
+};
+#endif
+
+#ifdef CALIBRATE_EXCESS
+// What calibrate() has measured for one receiver: histograms of how much longer than they should have been the MARKs 
+// of the frames it decoded were, and how much shorter their SPACEs, in CALIBRATE_STEP us buckets from CALIBRATE_MIN
+struct LRcalibration {
+	uint16_t marks[CALIBRATE_BUCKETS];
+	uint16_t spaces[CALIBRATE_BUCKETS];
+	int excess;										// The receiver's MARK excess (us) as of now
+};
+#endif
+
+// The capture state of one receiver: everything the ISRs touch. See LRremote.cpp.
+struct LRcapture {
+	int recvpin;										// Pin that the IR receiver is attached to
+	int captureMode;									// CAPTURE_POLL or CAPTURE_EDGE, set by enable()
+	volatile uint8_t *pinReg;							// The receiver pin's port input register, set by enable()
+	uint8_t pinMask;									// And its bit in there
+	uint8_t portIx;										// Index of pinReg in the timer ISR's list of ports
+	volatile int rcvstate;								// The state of the ISR state machine
+	volatile unsigned int timer;						// State timer, counts 50uS ticks.
+	volatile uint8_t *framebuf;							// Raw data, RAWFRAMES slots of one transmission each
+	unsigned int frameCap;								// Count of entries a slot can hold
+	uint8_t rawSize;									// Size of an entry, 1 or 2 bytes
+	unsigned int rawLong;								// Largest value an entry can hold: the escape
+	volatile unsigned int framelen[RAWFRAMES];			// Count of entries in each slot of framebuf
+	volatile unsigned int framegap[RAWFRAMES];			// The gap before each slot's transmission, if rawLong or more
+	volatile unsigned long frameTime[RAWFRAMES];		// micros() when each slot's transmission was complete
+#ifdef LATENCY_STATS
+	volatile unsigned long frameStart[RAWFRAMES];		// micros() when each slot's transmission started
+#endif
+	volatile uint8_t *capbuf;							// The slot the ISR is recording into
+	volatile unsigned int caplen;						// Count of entries in capbuf
+	volatile uint8_t frameHead;							// Frames recorded by the ISR (free running)
+	volatile uint8_t frameTail;							// Frames released by resume() (free running)
+	volatile unsigned int overrunCount;					// Transmissions missed because every slot was full
+	volatile unsigned long lastEdge;					// micros() at the last transition seen by the edge ISR
+#ifdef VALIDATE_FRAMES
+	long address;										// NEC/Samsung address frames must have; -1 for any
+#endif
+#ifdef CALIBRATE_EXCESS
+	volatile int8_t markTicks;							// Ticks record() takes off each MARK and adds to each SPACE
+	volatile int markUs;								// us the edge ISR takes off each MARK and adds to each SPACE
+#endif
+#ifdef STREAM_DECODE
+	volatile DecodeResult frameResult[RAWFRAMES];		// What the streaming decoders made of each slot
+	uint8_t streamAlive;								// Bit i: streaming decoder i still matches, not finished
+	uint8_t streamDone;									// Bit i: streaming decoder i matched a whole frame
+	unsigned int streamBlockers;						// PROTOCOL_BIT()s of candidates that can't be streamed
+	uint32_t streamValue[PULSE_PROTOCOLS];				// Bits so far, for each streaming decoder
+	unsigned int streamHigh;							// Bits shifted out the top of a streamValue[] (Panasonic)
+#endif
+};
+
+// main class for receiving IR. Sketches declare an LRremote, or an LRremoteBuf (below) to size its buffer.
+class LRreceiver
 {
 public:
-	LRremote(int rpin);												// Constructor
-	void enable();													// Enable timer interrupts
+	bool enable(int mode = CAPTURE_POLL);							// Enable capture interrupts
+	bool read(LRevent &event);										// Get the next decoded transmission, if any
+	bool poll(DecodeResult &result);								// Same, without the time
+	void service();													// Decode waiting transmissions into the queue
 	bool onButton(long code[], void (*fButton[])(), int codeCount);	// Button function invoker
+	bool onButton(const LRkey keymap[], int keyCount);				// Same, for a keymap sorted by code
+	static void sortKeys(LRkey keymap[], int keyCount);				// Sort a keymap by code
+	bool onButton_P(const LRbinding bindings[], int bindingCount);	// Same, for a PROGMEM binding table sorted by code
+	unsigned int overruns();										// Transmissions lost to a full buffer
+	void dispatched(const LRevent &event);							// Note that event has been acted on
+#ifdef DECODE_STATS
+	static void getStats(LRstats &stats, bool reset = false);		// Copy (and clear) the statistics counters
+#endif
+#ifdef LATENCY_STATS
+	static void getLatency(LRlatency &histogram, bool reset = false);	// Copy (and clear) the latency histograms
+	static void printLatency(Print &out);							// Print them, e.g. to Serial
+#endif
+	void setRepeat(unsigned int delayMs, unsigned int rateMs,		// Set how onButton() repeats held buttons
+		unsigned int fastestMs = REPEAT_FASTEST, uint8_t accel = REPEAT_ACCEL);
+#ifdef VALIDATE_FRAMES
+	void setAddress(long address = -1);								// Take NEC/Samsung frames only from address
+#endif
+#ifdef CALIBRATE_EXCESS
+	void calibrate(bool on = true);									// Measure and correct for the MARK excess
+	int markExcess();												// The MARK excess (us) being corrected for
+	void setMarkExcess(int us);										// Correct for us, e.g. as saved earlier
+	void getCalibration(LRcalibration &calibration);				// Copy the histograms behind it
+#endif
+#if LR_DECODES(LEARNED)
+	void learn(LRtemplate *tmpl);									// Learn the next frame into *tmpl (0: stop)
+	bool learning();												// Still waiting for a frame to learn?
+	void setTemplates(const LRtemplate templates[], uint8_t count);	// The learned buttons to look for
+#endif
+
+protected:
+	LRreceiver(int rpin, volatile void *buffer, unsigned int capacity, uint8_t rawSize);	// Constructor
 
 private:
+	friend class LRhost;						// Host-side test and benchmark driver (extras/host)
+
 	// Instance variables
+	LRcapture cap;								// Capture state, shared with the ISRs
 	int decode_type;							// NEC, SONY, RC5, etc.
 	unsigned int panasonicAddress;				// This is only used for decoding Panasonic data
+#ifdef HASH_64
+	unsigned long hashHigh;						// The high 32 bits of decodeHash()'s hash
+#endif
 	unsigned long value;						// Decoded value
 	int bits;									// Number of bits in decoded value
-	long lastValue;								// Value last time a button pushed (for REPEAT processing)
-	int repeat;									// How many times the REPEAT code was received in a row
+	LRcode lastValue;							// Code of the button last pushed (for REPEAT processing)
+	int lastIx;									// Where lastValue was found in the table (for REPEAT processing)
+	bool holding;								// lastValue's button may still be held down
+	unsigned long lastFrame;					// micros() its last frame ended
+	unsigned long framePeriod;					// micros() between its last two frames; 0 if there's been only one
+	unsigned long nextRepeat;					// micros() it's next due to repeat
+	unsigned long repeatGap;					// micros() between repeats, as of now
+	unsigned int repeatDelay;					// Repeat settings, in ms (see setRepeat())
+	unsigned int repeatRate;
+	unsigned int repeatFastest;
+	uint8_t repeatAccel;
+	const uint8_t *rawbuf;						// The frame slot being decoded
+	unsigned int rawlen;						// Count of entries in rawbuf
+	unsigned int rawgap;						// The gap before it, if rawbuf[0] is cap.rawLong
+	volatile LRevent events[EVENT_QUEUE];		// Decoded transmissions waiting for read()
+	volatile uint8_t eventHead;					// Events queued by service() (free running)
+	volatile uint8_t eventTail;					// Events taken by read() (free running)
+	volatile unsigned int eventDrops;			// Transmissions lost because the queue was full
+#ifdef VALIDATE_FRAMES
+	bool invalid;								// The frame being decoded failed an integrity check
+#endif
+#ifdef CALIBRATE_EXCESS
+	bool calibrating;							// Measuring the MARK excess (see calibrate())
+	LRcalibration calibration;					// What it's measured
+#endif
+#if LR_DECODES(LEARNED)
+	LRtemplate *volatile learnInto;				// Where to learn the next frame; 0 if not learning
+	const LRtemplate *templates;				// The learned buttons decode() looks for (see setTemplates())
+	uint8_t templateCount;						// Count of entries in templates[]
+#endif
 
 	// Methods
 	void resume();								// Resume collecting transmitted values
 	bool decode();								// Decode collected MARKs and SPACEs and place in value
-	bool decodeNEC();							//   Decoders and helpers for various types of remotes
+	bool decodeFrame(unsigned int candidates);	// Decode the frame in rawbuf, trying candidates' classified decoders
+	unsigned int rawTicks(unsigned int ix);		// Entry ix of rawbuf, in ticks; cap.rawLong if that or longer
+	unsigned int gapTicks();					// The gap before rawbuf's transmission, in ticks
+	unsigned int classify();					// Decide from the header which decoders might match
+#if PULSE_PROTOCOLS != 0						//   Decoders and helpers for the types of remotes in LR_PROTOCOLS
+	bool decodePulseDistance(const struct PulseProtocol &p);
+#endif
+#if LR_DECODES(SONY)
 	bool decodeSony();
+#endif
+#if LR_DECODES(SANYO)
 	bool decodeSanyo();
+#endif
+#if LR_DECODES(MITSUBISHI)
 	bool decodeMitsubishi();
-	int getRClevel(int *offset, int *used, int t1);
+#endif
+#if LR_DECODES(RC5) || LR_DECODES(RC6)
+	int getRClevel(int *offset, int *used, const struct RClevels &levels);
+#endif
+#if LR_DECODES(RC5)
 	bool decodeRC5();
+#endif
+#if LR_DECODES(RC6)
 	bool decodeRC6();
-	bool decodePanasonic();
-	bool decodeLG();
-	bool decodeJVC();
-	bool decodeSAMSUNG();
+#endif
+#if LR_DECODES(LEARNED)
+	bool makeTemplate(LRtemplate &tmpl);
+	bool decodeLearned();
+#endif
+#if LR_DECODES(UNKNOWN)
 	int compare(unsigned int oldval, unsigned int newval);
 	bool decodeHash();
+#endif
+#ifdef CALIBRATE_EXCESS
+	void measureExcess();						// Add the frame just decoded to calibration
+#endif
+	bool keyAction(const LRevent *event, LRcode &code);	// The repeat engine: should a button act now?
+	static int findKey(const LRkey keymap[], int keyCount, LRcode code);
+	static int findBinding(const LRbinding bindings[], int bindingCount, LRcode code);
 } 
 ;
 
+/*
+ * An IR receiver whose buffer holds CAPACITY entries per frame slot, each a RAW: uint8_t, or uint16_t for a sketch 
+ * that would rather spend the RAM than have long durations escaped. The buffer is part of the object, so its size is
+ * settled at compile time and costs nothing at run time. E.g., for a remote whose frames run to 300 transitions:
+ *
+ *   LRremoteBuf<300> aircon(RECV_PIN);
+ *
+ */
+template <unsigned int CAPACITY = RAWBUF, typename RAW = LRraw>
+class LRremoteBuf : public LRreceiver
+{
+	static_assert(CAPACITY >= 4, "An LRremoteBuf needs room for at least a header");
+	static_assert((RAW)-1 == 0xFF || (RAW)-1 == 0xFFFF, "An LRremoteBuf's entries must be uint8_t or uint16_t");
+
+public:
+	LRremoteBuf(int rpin) : LRreceiver(rpin, framebuf, CAPACITY, sizeof(RAW)) {}	// Constructor
+
+private:
+	volatile RAW framebuf[RAWFRAMES][CAPACITY];	// The frame slots
+};
+
+// The receiver most sketches want: RAWBUF LRraw entries per frame slot
+typedef LRremoteBuf<> LRremote;
+
+#ifdef IR_SEND
+/*
+ * The IR sender. There's only the one, on the one timer, so it's all static: LRsender::send(frame, 67) and so on. 
+ * send() returns at once; the frame goes out from the timer interrupt, and sending() says when it's gone.
+ *
+ */
+class LRsender
+{
+public:
+	static bool send(const unsigned int durations[], unsigned int count, uint8_t khz = 38);	// MARK, SPACE, ... (us)
+	static bool sendNEC(unsigned long data);						// Send an NEC frame, or REPEAT
+	static bool sending();											// Still sending?
+};
+#endif
+
 #endif
@@ -18,6 +18,32 @@
 #include <WProgram.h>
 #endif
 
+// Host builds (extras/host) count the basic operations of decoding to estimate what they'd cost on the board.
+// On the board this is nothing.
+#ifndef LR_COUNT
+#define LR_COUNT(what)
+#endif
+
+// Counts one of the statistics in lrStats, the library's LRstats, if DECODE_STATS is defined
+#ifdef DECODE_STATS
+#define LR_STAT(counter) (lrStats.counter++)
+#define LR_STAT_TYPE(type) ((type) < 0 ? 0 : (type))	// Index in LRstats.decoded[] and rejected[] for a decode_type
+#else
+#define LR_STAT(counter)
+#endif
+
+// Called by service() as it queues each decoded transmission, while the frame is still in rawbuf. Host builds keep a
+// copy of the frame; on the board this is nothing.
+#ifndef LR_FRAME_DECODED
+#define LR_FRAME_DECODED(receiver)
+#endif
+
+// The ISRs sample the receivers by reading the port input registers directly, when the core says which register and
+// bit each pin is. Otherwise, or if LR_USE_DIGITALREAD is defined, they use digitalRead().
+#if defined(portInputRegister) && !defined(LR_USE_DIGITALREAD)
+#define LR_PORT_SAMPLING
+#endif
+
 // define which timer to use
 //
 // Uncomment the timer you wish to use on your board.  If you
@@ -98,14 +124,14 @@
 #define SONY_ONE_MARK	1200
 #define SONY_ZERO_MARK	600
 #define SONY_RPT_LENGTH 45000
-#define SONY_DOUBLE_SPACE_USECS  500  // usually ssee 713 - not using ticks as get number wrapround
+#define SONY_DOUBLE_SPACE_TICKS  500  // Shorter gap (25ms) means a fast repeat; usually see 713
 
 // SA 8650B
 #define SANYO_HDR_MARK	3500  // seen range 3500
 #define SANYO_HDR_SPACE	950 //  seen 950
 #define SANYO_ONE_MARK	2400 // seen 2400  
 #define SANYO_ZERO_MARK 700 //  seen 700
-#define SANYO_DOUBLE_SPACE_USECS  800  // usually ssee 713 - not using ticks as get number wrapround
+#define SANYO_DOUBLE_SPACE_TICKS  800  // Shorter gap (40ms) means a fast repeat; usually see 713
 #define SANYO_RPT_LENGTH 45000
 
 // Mitsubishi RM 75501
@@ -174,16 +200,21 @@
 #define DISH_BITS 16
 
 #define TOLERANCE 25  // percent tolerance in measurements
-#define LTOL (1.0 - TOLERANCE/100.) 
-#define UTOL (1.0 + TOLERANCE/100.) 
 
 #define USECPERTICK 50  // microseconds per clock interrupt tick
 
+// Round a 16-bit microsecond count to ticks. Multiplies by a 16.16 reciprocal so the edge ISR doesn't need a divide.
+#define TICK_RECIPROCAL ((65536UL + USECPERTICK - 1) / USECPERTICK)
+#define USEC_TO_TICKS(us) ((unsigned int)((((unsigned long)(us) + USECPERTICK / 2) * TICK_RECIPROCAL) >> 16))
+
 #define _GAP 5000 // Minimum gap between transmissions
 #define GAP_TICKS (_GAP/USECPERTICK)
+#define GAP_MAX_TICKS (0xFFFF/USECPERTICK) // Longest gap recorded (65ms); anything longer is recorded as this
 
-#define TICKS_LOW(us) (int) (((us)*LTOL/USECPERTICK))
-#define TICKS_HIGH(us) (int) (((us)*UTOL/USECPERTICK + 1))
+// Bounds, in ticks, for a duration of us microseconds. Integer arithmetic only: given a constant, the compiler
+// works these out and the run-time test is a pair of integer compares. No floating point gets linked in.
+#define TICKS_LOW(us) (int) ((long)(us) * (100 - TOLERANCE) / (100L * USECPERTICK))
+#define TICKS_HIGH(us) (int) ((long)(us) * (100 + TOLERANCE) / (100L * USECPERTICK) + 1)
 
 // receiver states
 #define STATE_IDLE     2
@@ -226,6 +257,7 @@
   OCR2A = pwmval; \
   OCR2B = pwmval / 3; \
 })
+#define TIMER_KHZ_INTRS      1  /* ISR calls per carrier cycle */
 #define TIMER_COUNT_TOP      (SYSCLOCK * USECPERTICK / 1000000)
 #if (TIMER_COUNT_TOP < 256)
 #define TIMER_CONFIG_NORMAL() ({ \
@@ -273,6 +305,7 @@
   ICR1 = pwmval; \
   OCR1A = pwmval / 3; \
 })
+#define TIMER_KHZ_INTRS      2  /* ISR calls per carrier cycle */
 #define TIMER_CONFIG_NORMAL() ({ \
   TCCR1A = 0; \
   TCCR1B = _BV(WGM12) | _BV(CS10); \
@@ -305,6 +338,7 @@
   ICR3 = pwmval; \
   OCR3A = pwmval / 3; \
 })
+#define TIMER_KHZ_INTRS      2  /* ISR calls per carrier cycle */
 #define TIMER_CONFIG_NORMAL() ({ \
   TCCR3A = 0; \
   TCCR3B = _BV(WGM32) | _BV(CS30); \
@@ -340,6 +374,7 @@
   TC4H = (pwmval / 3) >> 8; \
   OCR4A = (pwmval / 3) & 255; \
 })
+#define TIMER_KHZ_INTRS      1  /* ISR calls per carrier cycle */
 #define TIMER_CONFIG_NORMAL() ({ \
   TCCR4A = 0; \
   TCCR4B = _BV(CS40); \
@@ -375,6 +410,7 @@
   ICR4 = pwmval; \
   OCR4A = pwmval / 3; \
 })
+#define TIMER_KHZ_INTRS      2  /* ISR calls per carrier cycle */
 #define TIMER_CONFIG_NORMAL() ({ \
   TCCR4A = 0; \
   TCCR4B = _BV(WGM42) | _BV(CS40); \
@@ -405,6 +441,7 @@
   ICR5 = pwmval; \
   OCR5A = pwmval / 3; \
 })
+#define TIMER_KHZ_INTRS      2  /* ISR calls per carrier cycle */
 #define TIMER_CONFIG_NORMAL() ({ \
   TCCR5A = 0; \
   TCCR5B = _BV(WGM52) | _BV(CS50); \
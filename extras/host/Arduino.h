@@ -0,0 +1,127 @@
+/*
+ * Arduino.h -- Host (Linux) stand-in for the Arduino core
+ *
+ * Just enough of the Arduino and AVR environment for LRremote.cpp to compile and run on a build server: pins,
+ * micros()/millis(), external interrupts, Serial and the timer registers the TIMER_* macros in LRremoteInt.h 
+ * write to. The hardware behind all of it is simulated by LRhost (see LRhost.h), which is also what tests and 
+ * benchmarks use to feed the receiver a waveform and run the timer ISR tick by tick.
+ *
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))	// As on an Uno
+
+// Port input registers (PINx), simulated by LRhost. Pins are numbered straight through the ports, 8 to a port.
+#define NUM_DIGITAL_PINS 70
+#define NOT_A_PORT 0
+extern volatile uint8_t hostPortInput[(NUM_DIGITAL_PINS + 7) / 8];
+#define digitalPinToPort(p) ((p) < NUM_DIGITAL_PINS ? (p) / 8 + 1 : NOT_A_PORT)
+#define digitalPinToBitMask(p) ((uint8_t)(1 << ((p) % 8)))
+#define portInputRegister(port) (&hostPortInput[(port) - 1])
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// Digital I/O and time, as simulated by LRhost
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// External interrupts
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(), int mode);
+void detachInterrupt(uint8_t interruptNum);
+void interrupts();
+void noInterrupts();
+
+// Serial writes to stdout
+class Print {
+public:
+	void print(const char *s);
+	void print(char c);
+	void print(int n, int base = DEC);
+	void print(unsigned int n, int base = DEC);
+	void print(long n, int base = DEC);
+	void print(unsigned long n, int base = DEC);
+	void println();
+	template <typename T> void println(T x) {print(x); println();}
+	template <typename T> void println(T x, int base) {print(x, base); println();}
+};
+extern Print Serial;
+
+// The AVR registers touched by the TIMER_* and BLINKLED macros. Timer 2, the default, is the only one simulated.
+extern volatile uint8_t SREG;
+extern volatile uint8_t TCCR2A, TCCR2B, OCR2A, OCR2B, TCNT2, TIMSK2;
+extern volatile uint8_t PORTB, PORTD;
+
+#define _BV(bit) (1 << (bit))
+#define _SFR_BYTE(sfr) (sfr)
+
+#define WGM20 0
+#define WGM21 1
+#define COM2B0 4
+#define COM2B1 5
+#define WGM22 3
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+
+// Operation counts for estimating AVR cycles; see LR_COUNT in LRremoteInt.h. What the ISRs do is counted separately,
+// in lrIsrCounts: LRhost points lrCounting at it while it runs one.
+struct LRcounts {
+	unsigned long matches;				// Duration range tests
+	unsigned long hashSteps;			// decodeHash() comparisons
+	unsigned long ticks;				// Timer ISR invocations
+	unsigned long edges;				// Edge ISR invocations
+	unsigned long samples;				// Receivers sampled by the timer ISR
+	unsigned long pinReads;				// digitalRead() calls
+	unsigned long portReads;			// Port input register reads
+	unsigned long records;				// Durations recorded
+};
+extern LRcounts lrCounts, lrIsrCounts;
+extern LRcounts *lrCounting;
+#define LR_COUNT(what) (lrCounting->what++)
+
+// Keeps a copy of each frame service() queues, for LRhost::decode(); see LR_FRAME_DECODED in LRremoteInt.h
+class LRreceiver;
+void lrFrameDecoded(LRreceiver &receiver);
+#define LR_FRAME_DECODED(receiver) lrFrameDecoded(receiver)
+
+#define B00000001 1
+#define B00100000 32
+#define B01111111 127
+#define B10000000 128
+#define B11011111 223
+#define B11111110 254
+
+#endif
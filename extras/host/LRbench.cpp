@@ -0,0 +1,174 @@
+/*
+ * LRbench.cpp -- Decode throughput and latency benchmark for LRremote on the host
+ *
+ * Usage: LRbench [-a] [-c] [-n iterations] corpus-file...
+ *
+ * Each non-blank line of a corpus file that doesn't start with '#' is one frame, as the ISR would have recorded it: 
+ * the protocol it was sent as (or NONE if it's noise nothing should decode), then the rawbuf[] entries in ticks. 
+ * LRreplay -r makes them from waveform captures; captures/corpus.raw has every supported protocol, repeats, a 
+ * remote none of the decoders know and some noise.
+ *
+ * Every frame is decoded once to check the result and count the basic operations (see LR_COUNT) and then 
+ * iterations times to time it. For each frame, LRbench reports the time per decode on this machine and an estimate 
+ * of the cycles it would take on a 16MHz AVR, worked out from the operation counts and the costs below. Then it 
+ * summarizes by protocol, including the worst case. With -c it prints one CSV line per frame instead, for keeping
+ * track over time.
+ *
+ * A frame that decodes as something other than what it was sent as is flagged MISMATCH and makes the exit status 1.
+ *
+ * With -a, every decoder tries every frame, as they did before decode() looked the header up in headerClass[], 
+ * instead of only the ones it says the header could belong to. "make cascade" runs the corpus both ways, so what the
+ * header classification saves can be read off the two summaries.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "LRhost.h"
+
+// Rough cost of each counted operation on an ATmega328P, in cycles. They're only an estimate; what matters is that 
+// they stay the same from run to run so the numbers can be compared.
+#define FRAME_CYCLES 200			// Getting a frame, classifying it and returning the results
+#define MATCH_CYCLES 16				// Fetching a duration, testing it against a pair of bounds, shifting in a bit
+#define HASH_STEP_CYCLES 150		// One compare() and FNV step in decodeHash
+
+#define MAX_FRAMES 1000
+#define MAX_PROTOCOLS (LEARNED + 2)	// UNKNOWN, NONE and 1..LEARNED
+
+struct Frame {
+	char label[16];					// What it was sent as
+	int expected;					// The decode_type that goes with it; 0 for NONE
+	unsigned int raw[HOST_RAWBUF];
+	unsigned int rawlen;
+};
+
+static Frame frames[MAX_FRAMES];
+
+static double nowNs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int readCorpus(const char *name, int count) {
+	FILE *f = fopen(name, "r");
+	if (!f) {
+		perror(name);
+		return -1;
+	}
+	char line[8192];
+	while (count < MAX_FRAMES && fgets(line, sizeof(line), f)) {
+		char *tok = strtok(line, " \t\r\n,");
+		if (!tok || *tok == '#') {
+			continue;
+		}
+		Frame &fr = frames[count];
+		snprintf(fr.label, sizeof(fr.label), "%s", tok);
+		fr.expected = LRhost::protocolType(tok);
+		if (fr.expected == 0 && strcmp(tok, "NONE") != 0) {
+			fprintf(stderr, "%s: unknown protocol %s\n", name, tok);
+			continue;
+		}
+		fr.rawlen = 0;
+		while ((tok = strtok(NULL, " \t\r\n,")) && fr.rawlen < HOST_RAWBUF) {
+			fr.raw[fr.rawlen++] = strtoul(tok, NULL, 10);
+		}
+		count++;
+	}
+	fclose(f);
+	return count;
+}
+
+int main(int argc, char *argv[]) {
+	bool csv = false;
+	bool everyDecoder = false;
+	long iterations = 20000;
+	int argi;
+	for (argi = 1; argi < argc && argv[argi][0] == '-'; argi++) {
+		if (strcmp(argv[argi], "-a") == 0) {
+			everyDecoder = true;
+		} else if (strcmp(argv[argi], "-c") == 0) {
+			csv = true;
+		} else if (strcmp(argv[argi], "-n") == 0 && argi + 1 < argc) {
+			iterations = atol(argv[++argi]);
+		} else {
+			break;
+		}
+	}
+	if (argi >= argc || iterations <= 0) {
+		fprintf(stderr, "Usage: %s [-a] [-c] [-n iterations] corpus-file...\n", argv[0]);
+		return 2;
+	}
+	int count = 0;
+	for (; argi < argc; argi++) {
+		if ((count = readCorpus(argv[argi], count)) < 0) {
+			return 2;
+		}
+	}
+
+	LRhost::reset();
+	LRremote remote(3);
+	LRhostResult result;
+
+	struct {
+		int frames;
+		double ns, worstNs;
+		unsigned long cycles, worstCycles;
+	} summary[MAX_PROTOCOLS];
+	memset(summary, 0, sizeof(summary));
+	int mismatches = 0;
+
+	if (csv) {
+		printf("frame,sent,decoded,ok,rawlen,matches,hash_steps,ns_per_frame,est_avr_cycles\n");
+	}
+	for (int i = 0; i < count; i++) {
+		Frame &fr = frames[i];
+		memset(&lrCounts, 0, sizeof(lrCounts));
+		bool decoded = LRhost::decodeRaw(remote, fr.raw, fr.rawlen, result, everyDecoder);
+		LRcounts counts = lrCounts;
+		int got = decoded ? result.decode_type : 0;
+		bool ok = got == fr.expected;
+		mismatches += !ok;
+
+		double start = nowNs();
+		for (long n = 0; n < iterations; n++) {
+			LRhost::decodeRaw(remote, fr.raw, fr.rawlen, result, everyDecoder);
+		}
+		double ns = (nowNs() - start) / iterations;
+		unsigned long cycles = FRAME_CYCLES + MATCH_CYCLES * counts.matches + HASH_STEP_CYCLES * counts.hashSteps;
+
+		const char *gotName = decoded ? LRhost::protocolName(got) : "NONE";
+		if (csv) {
+			printf("%d,%s,%s,%d,%u,%lu,%lu,%.1f,%lu\n", i, fr.label, gotName, ok, fr.rawlen, counts.matches, 
+				counts.hashSteps, ns, cycles);
+		} else if (!ok) {
+			printf("MISMATCH: frame %d sent as %s decoded as %s\n", i, fr.label, gotName);
+		}
+		int slot = fr.expected < 0 ? 0 : (fr.expected == 0 ? MAX_PROTOCOLS - 1 : fr.expected);
+		summary[slot].frames++;
+		summary[slot].ns += ns;
+		summary[slot].cycles += cycles;
+		if (ns > summary[slot].worstNs) {
+			summary[slot].worstNs = ns;
+		}
+		if (cycles > summary[slot].worstCycles) {
+			summary[slot].worstCycles = cycles;
+		}
+	}
+	if (!csv) {
+		printf("Decoders: %s\n", everyDecoder ? "every one on every frame (-a)" : "classified by header");
+		printf("%-12s %6s %10s %10s %12s %12s\n", "protocol", "frames", "ns/frame", "worst ns", "est cycles", 
+			"worst cycles");
+		for (int slot = 0; slot < MAX_PROTOCOLS; slot++) {
+			if (summary[slot].frames == 0) {
+				continue;
+			}
+			printf("%-12s %6d %10.1f %10.1f %12lu %12lu\n", 
+				slot == MAX_PROTOCOLS - 1 ? "NONE" : LRhost::protocolName(slot ? slot : UNKNOWN), 
+				summary[slot].frames, summary[slot].ns / summary[slot].frames, summary[slot].worstNs, 
+				summary[slot].cycles / summary[slot].frames, summary[slot].worstCycles);
+		}
+	}
+	return mismatches ? 1 : 0;
+}
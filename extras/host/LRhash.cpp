@@ -0,0 +1,179 @@
+/*
+ * LRhash.cpp -- Hash every frame of a capture corpus the way decodeHash() would and report any collisions
+ *
+ * Usage: LRhash [-v] corpus-file...
+ *
+ * The corpus files are in LRbench's format: one frame per line, the protocol it was sent as (or NONE), then the
+ * rawbuf[] entries in ticks. Every frame long enough to hash is hashed, whatever the decoders make of it, since a
+ * build whose LR_PROTOCOLS leaves out its protocol would hash it too. What button a frame is comes from the decoders:
+ * its protocol and value if one recognizes it, otherwise the sequence of compare() results the hash is made from.
+ *
+ * Two frames of the same button hashing alike is what's wanted. Two buttons hashing alike is a collision, printed as
+ *
+ *   COLLISION 0xHASH file:line BUTTON, file:line BUTTON, ...
+ *
+ * If the buttons' compare() sequences are the same too, no hash can tell them apart, and the line says so. Then comes
+ * a summary, and the exit status is 1 if there were any collisions. -v lists every frame's hash as well.
+ *
+ * LRhash is the default 32-bit FNV-1 hash; LRhash64 is the same tool built with HASH_64 (64-bit FNV-1a). "make hash"
+ * runs both on captures/corpus.raw.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LRhost.h"
+
+#define MAX_FRAMES 5000
+#define MAX_BUTTON 64								// Longest description of a decoded button
+
+struct Frame {
+	const char *file;
+	int lineNo;
+	unsigned long long hash;
+	char button[MAX_BUTTON];						// What the decoders say it is; empty if only its symbols say
+	char *symbols;									// The compare() results hashed
+};
+
+static Frame frames[MAX_FRAMES];
+static int frameCount;
+
+/*
+ * sameButton() -- Are frames a and b the same button?
+ *
+ */
+static bool sameButton(const Frame &a, const Frame &b) {
+	if (a.button[0] || b.button[0]) {
+		return strcmp(a.button, b.button) == 0;
+	}
+	return strcmp(a.symbols, b.symbols) == 0;
+}
+
+/*
+ * printButton() -- Print which button frame is.
+ *
+ */
+static void printButton(const Frame &frame) {
+	printf("%s:%d %s", frame.file, frame.lineNo, frame.button[0] ? frame.button : "UNKNOWN");
+}
+
+static int byHash(const void *a, const void *b) {
+	unsigned long long x = ((const Frame *)a)->hash, y = ((const Frame *)b)->hash;
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * readCorpus() -- Hash every frame in the corpus file name into frames[]. Returns false if it can't be read.
+ *
+ */
+static bool readCorpus(LRreceiver &remote, const char *name) {
+	FILE *f = fopen(name, "r");
+	if (!f) {
+		perror(name);
+		return false;
+	}
+	static char line[8192];
+	static unsigned int raw[HOST_RAWBUF];
+	static char symbols[HOST_RAWBUF];
+	static LRhostResult result;
+	for (int lineNo = 1; frameCount < MAX_FRAMES && fgets(line, sizeof(line), f); lineNo++) {
+		char *tok = strtok(line, " \t\r\n,");
+		if (!tok || *tok == '#') {
+			continue;
+		}
+		unsigned int rawlen = 0;
+		while ((tok = strtok(NULL, " \t\r\n,")) && rawlen < HOST_RAWBUF) {
+			raw[rawlen++] = strtoul(tok, NULL, 10);
+		}
+		if (!LRhost::hashRaw(remote, raw, rawlen, result, symbols)) {
+			continue;										// Too short to hash: noise
+		}
+		Frame &frame = frames[frameCount++];
+		frame.file = name;
+		frame.lineNo = lineNo;
+		frame.hash = (unsigned long long)result.hashHigh << 32 | result.value;
+		frame.symbols = strdup(symbols);
+		frame.button[0] = 0;
+		if (LRhost::decodeRaw(remote, raw, rawlen, result) && result.decode_type != UNKNOWN) {
+			snprintf(frame.button, sizeof(frame.button), "%s 0x%08lX %d", LRhost::protocolName(result.decode_type),
+				result.value, result.bits);
+			if (result.decode_type == PANASONIC) {
+				snprintf(frame.button + strlen(frame.button), sizeof(frame.button) - strlen(frame.button),
+					" address 0x%04X", result.panasonicAddress);
+			}
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	bool verbose = false;
+	int argi;
+	for (argi = 1; argi < argc && argv[argi][0] == '-'; argi++) {
+		if (strcmp(argv[argi], "-v") == 0) {
+			verbose = true;
+		} else {
+			break;
+		}
+	}
+	if (argi >= argc) {
+		fprintf(stderr, "Usage: %s [-v] corpus-file...\n", argv[0]);
+		return 2;
+	}
+
+	LRhost::reset();
+	LRremoteBuf<HOST_RAWBUF, uint16_t> remote(3);
+	for (; argi < argc; argi++) {
+		if (!readCorpus(remote, argv[argi])) {
+			return 2;
+		}
+	}
+#ifdef HASH_64
+	const char *hashName = "64-bit FNV-1a";
+#else
+	const char *hashName = "32-bit FNV-1";
+#endif
+	if (verbose) {
+		for (int i = 0; i < frameCount; i++) {
+			printf("0x%016llX ", frames[i].hash);
+			printButton(frames[i]);
+			printf("\n");
+		}
+	}
+
+	// Sorted by hash, the frames that share one are side by side. Report each hash more than one button has.
+	qsort(frames, frameCount, sizeof(frames[0]), byHash);
+	int hashes = 0, collisions = 0, hopeless = 0;
+	for (int start = 0, end; start < frameCount; start = end) {
+		int distinct = 0;
+		bool sameSymbols = false;
+		for (end = start; end < frameCount && frames[end].hash == frames[start].hash; end++) {
+			bool seen = false;
+			for (int j = start; j < end && !seen; j++) {
+				seen = sameButton(frames[j], frames[end]);
+				sameSymbols |= !seen && strcmp(frames[j].symbols, frames[end].symbols) == 0;
+			}
+			distinct += !seen;
+		}
+		hashes++;
+		if (distinct < 2) {
+			continue;
+		}
+		collisions++;
+		hopeless += sameSymbols;
+		printf("COLLISION 0x%0*llX", frames[start].hash >> 32 ? 16 : 8, frames[start].hash);
+		for (int i = start; i < end; i++) {
+			printf(i == start ? " " : ", ");
+			printButton(frames[i]);
+		}
+		printf(sameSymbols ? " (same MARK/SPACE pattern: no hash can tell them apart)\n" : "\n");
+	}
+	printf("%s: %d frames, %d hashes, %d collisions", hashName, frameCount, hashes, collisions);
+	if (hopeless != 0) {
+		printf(" (%d of them in the MARK/SPACE patterns themselves)", hopeless);
+	}
+	printf("\n");
+	return collisions != 0;
+}
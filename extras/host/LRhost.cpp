@@ -0,0 +1,426 @@
+/*
+ * LRhost.cpp -- Simulated hardware for running LRremote on a host (Linux) machine
+ *
+ * See LRhost.h.
+ *
+ */
+
+#include <stdio.h>
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include "LRhost.h"
+
+extern "C" void TIMER2_COMPA_vect(void);		// The library's timer ISR
+
+/*
+ *
+ * Simulated machine state
+ *
+ */
+volatile uint8_t SREG;
+volatile uint8_t TCCR2A, TCCR2B, OCR2A, OCR2B, TCNT2, TIMSK2;
+volatile uint8_t PORTB, PORTD;
+volatile uint8_t hostPortInput[(NUM_DIGITAL_PINS + 7) / 8];
+Print Serial;
+LRcounts lrCounts, lrIsrCounts;
+LRcounts *lrCounting = &lrCounts;
+
+static unsigned long long now;					// CPU cycles since reset()
+static unsigned long long lastTimer;			// When the timer last interrupted
+static bool interruptsOn = true;				// Global interrupt enable
+static uint8_t pinLevel[HOST_PINS];
+static void (*extHandler[2])();					// Attached external interrupt handlers (INT0, INT1)
+static int extMode[2];
+static unsigned long long carrierEdges[HOST_RAWBUF + 1];	// When the carrier went on or off, since emitted()
+static unsigned int carrierCount;				// Count of entries in carrierEdges[]
+static bool carrierOn;							// Timer 2's PWM output is connected to the LED pin
+
+// The frames behind the events queued in each receiver, as lrFrameDecoded() copied them, kept in step with its queue
+struct LRhostFrames {
+	LRreceiver *receiver;
+	unsigned int raw[EVENT_QUEUE][HOST_RAWBUF];
+	unsigned int rawlen[EVENT_QUEUE];
+};
+#define HOST_RECEIVERS 8
+static LRhostFrames hostFrames[HOST_RECEIVERS];
+
+/*
+ * framesFor() -- The frames kept for receiver, claiming a free set if it has none yet (0 if there are none left).
+ *
+ */
+static LRhostFrames *framesFor(LRreceiver *receiver) {
+	for (int i = 0; i < HOST_RECEIVERS; i++) {
+		if (hostFrames[i].receiver == receiver || hostFrames[i].receiver == 0) {
+			hostFrames[i].receiver = receiver;
+			return &hostFrames[i];
+		}
+	}
+	return 0;
+}
+
+/*
+ * timerPeriod() -- CPU cycles between timer 2 compare A interrupts as currently configured; 0 if there are none.
+ *
+ */
+static unsigned long timerPeriod() {
+	static const unsigned int prescale[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+	if (!(TIMSK2 & _BV(OCIE2A))) {
+		return 0;
+	}
+	unsigned long clocks = prescale[TCCR2B & 7];
+	uint8_t wgm = (TCCR2A & 3) | ((TCCR2B >> WGM22) & 1) << 2;
+	switch (wgm) {
+		case 2:											// CTC: count 0..OCR2A
+			return clocks * (OCR2A + 1UL);
+		case 5:											// Phase correct PWM, TOP = OCR2A: up and back down
+			return clocks * 2UL * OCR2A;
+		default:										// Everything else counts through all 256 values
+			return clocks * 256UL;
+	}
+}
+
+/*
+ * runISR() -- Run an ISR the way the board would: with interrupts disabled on entry, and enabled again by the RETI 
+ * that ends it, whatever it did with them in between.
+ *
+ */
+static void runISR(void (*isr)()) {
+	interruptsOn = false;
+	lrCounting = &lrIsrCounts;
+	isr();
+	lrCounting = &lrCounts;
+	interruptsOn = true;
+}
+
+/*
+ * watchCarrier() -- Note when the timer's PWM output is connected to the IR LED or disconnected from it.
+ *
+ */
+static void watchCarrier() {
+	bool on = (TCCR2A & _BV(COM2B1)) != 0;
+	if (on != carrierOn) {
+		carrierOn = on;
+		if (carrierCount < HOST_RAWBUF + 1) {
+			carrierEdges[carrierCount++] = now;
+		}
+	}
+}
+
+void LRhost::reset() {
+	now = lastTimer = 0;
+	interruptsOn = true;
+	memset(pinLevel, HIGH, sizeof(pinLevel));
+	memset((void *)hostPortInput, 0xFF, sizeof(hostPortInput));
+	extHandler[0] = extHandler[1] = 0;
+	memset(hostFrames, 0, sizeof(hostFrames));
+	TCCR2A = TCCR2B = OCR2A = OCR2B = TCNT2 = TIMSK2 = 0;
+	carrierCount = 0;
+	carrierOn = false;
+}
+
+void LRhost::setPin(uint8_t pin, int level) {
+	level = level ? HIGH : LOW;
+	if (pin >= HOST_PINS || pinLevel[pin] == level) {
+		return;
+	}
+	pinLevel[pin] = level;
+	if (level) {
+		hostPortInput[pin / 8] |= 1 << (pin % 8);
+	} else {
+		hostPortInput[pin / 8] &= ~(1 << (pin % 8));
+	}
+	int intr = digitalPinToInterrupt(pin);
+	if (intr == NOT_AN_INTERRUPT || !extHandler[intr] || !interruptsOn) {
+		return;
+	}
+	if (extMode[intr] == CHANGE || (extMode[intr] == RISING && level) || (extMode[intr] == FALLING && !level)) {
+		runISR(extHandler[intr]);
+	}
+}
+
+int LRhost::getPin(uint8_t pin) {
+	return pin < HOST_PINS ? pinLevel[pin] : LOW;
+}
+
+void LRhost::advance(unsigned long us) {
+	unsigned long long target = now + (unsigned long long)us * (HOST_CLOCK / 1000000);
+	for (;;) {
+		unsigned long period = timerPeriod();
+		if (period == 0) {								// Timer interrupt off: nothing to do but wait
+			now = lastTimer = target;
+			return;
+		}
+		if (lastTimer + period > target) {
+			now = target;
+			return;
+		}
+		now = lastTimer += period;
+		if (interruptsOn) {
+			runISR(TIMER2_COMPA_vect);
+			watchCarrier();
+		}
+	}
+}
+
+void LRhost::tick() {
+	unsigned long period = timerPeriod();
+	if (period != 0) {
+		advance((lastTimer + period - now + HOST_CLOCK / 1000000 - 1) / (HOST_CLOCK / 1000000));
+	}
+}
+
+unsigned long long LRhost::cycles() {
+	return now;
+}
+
+unsigned int LRhost::emitted(unsigned long durations[], unsigned int max) {
+	unsigned int count = 0;
+	for (unsigned int i = 1; i < carrierCount && count < max; i++) {
+		durations[count++] = (unsigned long)((carrierEdges[i] - carrierEdges[i - 1]) / (HOST_CLOCK / 1000000));
+	}
+	carrierCount = 0;
+	if (carrierOn) {									// Still on: that MARK starts now
+		carrierEdges[carrierCount++] = now;
+	}
+	return count;
+}
+
+void LRhost::mark(uint8_t pin, unsigned long us) {
+	setPin(pin, LOW);
+	advance(us);
+}
+
+void LRhost::space(uint8_t pin, unsigned long us) {
+	setPin(pin, HIGH);
+	advance(us);
+}
+
+void LRhost::play(uint8_t pin, const unsigned long durations[], int count) {
+	for (int i = 0; i < count; i++) {
+		if (i % 2) {
+			space(pin, durations[i]);
+		} else {
+			mark(pin, durations[i]);
+		}
+	}
+	setPin(pin, HIGH);
+}
+
+void lrFrameDecoded(LRreceiver &receiver) {
+	LRhost::keepFrame(receiver);
+}
+
+void LRhost::keepFrame(LRreceiver &remote) {
+	LRhostFrames *frames = framesFor(&remote);
+	if (!frames) {
+		return;
+	}
+	uint8_t ix = remote.eventHead % EVENT_QUEUE;		// The event service() is about to queue
+	frames->rawlen[ix] = remote.rawlen;
+	for (unsigned int i = 0; i < remote.rawlen; i++) {
+		frames->raw[ix][i] = i == 0 ? remote.gapTicks() : remote.rawTicks(i);
+	}
+}
+
+bool LRhost::decode(LRreceiver &remote, LRhostResult &result) {
+	uint8_t ix = remote.eventTail % EVENT_QUEUE;		// The event read() will hand over, if there is one
+	LRevent event;
+	if (!remote.read(event)) {
+		return false;
+	}
+	remote.dispatched(event);							// Whoever called is acting on it
+	result.decode_type = event.decode_type;
+	result.value = event.value;
+	result.bits = event.bits;
+	result.panasonicAddress = event.address;
+#ifdef HASH_64
+	result.hashHigh = event.hashHigh;
+#else
+	result.hashHigh = 0;
+#endif
+	result.time = event.time;
+	LRhostFrames *frames = framesFor(&remote);
+	result.rawlen = frames ? frames->rawlen[ix] : 0;
+	for (unsigned int i = 0; i < result.rawlen; i++) {
+		result.raw[i] = frames->raw[ix][i];
+	}
+	return true;
+}
+
+/*
+ * loadRaw() -- Put raw[] in remote's rawbuf, stored the way record() would have.
+ *
+ */
+void LRhost::loadRaw(LRreceiver &remote, const unsigned int raw[], unsigned int rawlen) {
+	static uint16_t buf[HOST_RAWBUF];
+	for (unsigned int i = 0; i < rawlen; i++) {
+		unsigned int entry = raw[i] < remote.cap.rawLong ? raw[i] : remote.cap.rawLong;
+		if (remote.cap.rawSize == 1) {
+			((uint8_t *)buf)[i] = entry;
+		} else {
+			buf[i] = entry;
+		}
+	}
+	remote.rawbuf = (const uint8_t *)buf;
+	remote.rawlen = rawlen;
+	remote.rawgap = raw[0];
+}
+
+bool LRhost::decodeRaw(LRreceiver &remote, const unsigned int raw[], unsigned int rawlen, LRhostResult &result,
+		bool everyDecoder) {
+	loadRaw(remote, raw, rawlen);
+	bool answer = remote.decodeFrame(everyDecoder ? ~0U : remote.classify());
+	result.decode_type = answer ? remote.decode_type : 0;
+	result.value = answer ? remote.value : 0;
+	result.bits = answer ? remote.bits : 0;
+	result.panasonicAddress = answer ? remote.panasonicAddress : 0;
+#ifdef HASH_64
+	result.hashHigh = answer && remote.decode_type == UNKNOWN ? remote.hashHigh : 0;
+#else
+	result.hashHigh = 0;
+#endif
+	result.time = 0;
+	result.rawlen = 0;
+	return answer;
+}
+
+bool LRhost::hashRaw(LRreceiver &remote, const unsigned int raw[], unsigned int rawlen, LRhostResult &result,
+		char symbols[]) {
+	memset(&result, 0, sizeof(result));
+#if LR_DECODES(UNKNOWN)
+	loadRaw(remote, raw, rawlen);
+	if (symbols) {
+		unsigned int n = 0;
+		for (unsigned int i = 1; i + 2 < rawlen; i++) {
+			symbols[n++] = '0' + remote.compare(remote.rawTicks(i), remote.rawTicks(i + 2));
+		}
+		symbols[n] = 0;
+	}
+	if (!remote.decodeHash()) {
+		return false;
+	}
+	result.decode_type = remote.decode_type;
+	result.value = remote.value;
+	result.bits = remote.bits;
+#ifdef HASH_64
+	result.hashHigh = remote.hashHigh;
+#endif
+	return true;
+#else
+	return false;
+#endif
+}
+
+const char *LRhost::protocolName(int decode_type) {
+	static const char *const names[] = {"UNKNOWN", "NEC", "SONY", "RC5", "RC6", "DISH", "SHARP", "PANASONIC", 
+		"JVC", "SANYO", "MITSUBISHI", "SAMSUNG", "LG", "LEARNED"};
+	if (decode_type < 0 || decode_type >= (int)(sizeof(names) / sizeof(names[0]))) {
+		return names[0];
+	}
+	return names[decode_type];
+}
+
+int LRhost::protocolType(const char *name) {
+	for (int type = 1; type <= LEARNED; type++) {
+		if (strcmp(name, protocolName(type)) == 0) {
+			return type;
+		}
+	}
+	return strcmp(name, "UNKNOWN") == 0 ? UNKNOWN : 0;
+}
+
+/*
+ *
+ * The Arduino core functions declared in Arduino.h
+ *
+ */
+void pinMode(uint8_t pin, uint8_t mode) {
+	if (mode == INPUT_PULLUP) {
+		LRhost::setPin(pin, HIGH);
+	}
+}
+
+int digitalRead(uint8_t pin) {
+	LR_COUNT(pinReads);
+	return LRhost::getPin(pin);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+	LRhost::setPin(pin, val);
+}
+
+unsigned long micros() {
+	return (unsigned long)(now / (HOST_CLOCK / 1000000));
+}
+
+unsigned long millis() {
+	return (unsigned long)(now / (HOST_CLOCK / 1000));
+}
+
+void delay(unsigned long ms) {
+	LRhost::advance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+	LRhost::advance(us);
+}
+
+void attachInterrupt(uint8_t interruptNum, void (*userFunc)(), int mode) {
+	if (interruptNum < 2) {
+		extHandler[interruptNum] = userFunc;
+		extMode[interruptNum] = mode;
+	}
+}
+
+void detachInterrupt(uint8_t interruptNum) {
+	if (interruptNum < 2) {
+		extHandler[interruptNum] = 0;
+	}
+}
+
+void interrupts() {
+	interruptsOn = true;
+}
+
+void noInterrupts() {
+	interruptsOn = false;
+}
+
+void Print::print(const char *s) {
+	fputs(s, stdout);
+}
+
+void Print::print(char c) {
+	putchar(c);
+}
+
+void Print::print(int n, int base) {
+	print((long)n, base);
+}
+
+void Print::print(unsigned int n, int base) {
+	print((unsigned long)n, base);
+}
+
+void Print::print(long n, int base) {
+	if (n < 0 && base == DEC) {
+		putchar('-');
+		n = -n;
+	}
+	print((unsigned long)n, base);
+}
+
+void Print::print(unsigned long n, int base) {
+	char buf[8 * sizeof(long) + 1];
+	char *p = buf + sizeof(buf) - 1;
+	*p = '\0';
+	do {
+		*--p = "0123456789ABCDEF"[n % base];
+		n /= base;
+	} while (n);
+	fputs(p, stdout);
+}
+
+void Print::println() {
+	putchar('\n');
+}
@@ -0,0 +1,70 @@
+/*
+ * LRhost.h -- Simulated hardware for running LRremote on a host (Linux) machine
+ *
+ * The stand-in Arduino.h and avr/interrupt.h in this directory let LRremote.cpp compile unchanged for the host. 
+ * LRhost is the hardware behind them: a 16MHz clock, the pin levels, the external interrupts and timer 2. Tests
+ * and benchmarks drive it by setting the IR receiver's output and letting time pass. Whenever time passes, the
+ * timer ISR runs once per (simulated) timer period, just as it would on the board, and changing the receiver's 
+ * output runs the edge ISR if one is attached. Whatever the timer's PWM output does to the IR LED -- carrier on or off
+ * -- is noted as it happens, for emitted().
+ *
+ * LRhost is a friend of LRremote's (LRreceiver) so it can also get at the decode results directly.
+ *
+ */
+
+#ifndef LRhost_h
+#define LRhost_h
+
+#include <Arduino.h>
+#include "LRremote.h"
+
+#define HOST_CLOCK 16000000UL					// Simulated CPU clock (Hz)
+#define HOST_PINS NUM_DIGITAL_PINS				// Number of simulated digital pins
+#define HOST_RAWBUF 1024						// Most entries a frame can have, for LRremoteBufs of any size
+
+// The results of decoding one transmission
+struct LRhostResult {
+	int decode_type;
+	unsigned long value;
+	int bits;
+	unsigned int panasonicAddress;
+	unsigned long hashHigh;						// UNKNOWN with HASH_64: the high 32 bits of the hash
+	unsigned long time;							// micros() when the frame ended (decode() only)
+	unsigned int raw[HOST_RAWBUF];				// What was decoded, as recorded by the ISR (decode() only)
+	unsigned int rawlen;
+};
+
+class LRhost {
+public:
+	static void reset();												// Back to time zero, all pins HIGH
+	static void setPin(uint8_t pin, int level);							// Set a pin's input level
+	static int getPin(uint8_t pin);										// Get a pin's level
+	static void advance(unsigned long us);								// Let us microseconds pass
+	static void tick();													// Let time pass up to the next timer ISR
+	static unsigned long long cycles();									// Simulated CPU cycles so far
+
+	// Driving an IR receiver (active low) on pin
+	static void mark(uint8_t pin, unsigned long us);					// Receiver sees carrier for us
+	static void space(uint8_t pin, unsigned long us);					// Receiver sees nothing for us
+	static void play(uint8_t pin, const unsigned long durations[], int count);	// Alternating MARK, SPACE, ...
+
+	// Watching the IR LED on TIMER_PWM_PIN (LRsender)
+	static unsigned int emitted(unsigned long durations[], unsigned int max);	// MARKs, SPACEs sent since the last call
+
+	// Peeking at an LRremote (or an LRremoteBuf of any size)
+	static bool decode(LRreceiver &remote, LRhostResult &result);		// Read the next decoded transmission
+	static void keepFrame(LRreceiver &remote);							// Copy the frame service() is queueing
+	static bool decodeRaw(LRreceiver &remote, const unsigned int raw[], unsigned int rawlen, LRhostResult &result,
+		bool everyDecoder = false);										// Decode a frame given in ticks; with
+																		//   everyDecoder, unclassified
+	static bool hashRaw(LRreceiver &remote, const unsigned int raw[], unsigned int rawlen, LRhostResult &result,
+		char symbols[] = 0);											// Hash it, whatever it is; and
+																		//   the compare() results hashed
+	static const char *protocolName(int decode_type);					// "NEC", "SONY", ... "UNKNOWN"
+	static int protocolType(const char *name);							// And back again; 0 if no such
+
+private:
+	static void loadRaw(LRreceiver &remote, const unsigned int raw[], unsigned int rawlen);	// Put a frame in rawbuf
+};
+
+#endif
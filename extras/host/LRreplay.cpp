@@ -0,0 +1,348 @@
+/*
+ * LRreplay.cpp -- Play recorded IR waveforms into LRremote on the host and print what it decodes
+ *
+ * Usage: LRreplay [-a address] [-c] [-e] [-k us] [-l] [-r] [-s] [-t] [-m template-file] [-n receivers] [-w] [-x] 
+ *     capture-file...
+ *
+ * Each non-blank line of a capture file that doesn't start with '#' is one transmission: durations in microseconds,
+ * alternating MARK, SPACE, MARK, ... starting with a MARK. The waveform is fed to the receiver pin through the
+ * simulated hardware in LRhost, with the timer ISR sampling it every tick (or, with -e, the edge ISR timestamping 
+ * each transition), and 100ms of silence after each line. The decoded result of each transmission is printed as
+ *
+ *   file:line PROTOCOL 0xVALUE BITS
+ *
+ * With -l, decode() is polled every 10us while the waveform plays and each result is followed by its latency: how long
+ * after the last transition of the receiver's output it was ready.
+ *
+ * With -r, each decoded transmission is instead printed the way the ISR recorded it, in ticks, after the name of the 
+ * protocol it decoded as. That's the format LRbench reads.
+ *
+ * With -s, a summary of the work the ISRs did follows: how many times they ran and what they did, counted by LR_COUNT,
+ * and from that an estimate of the AVR cycles each interrupt takes. -n adds idle receivers, on pins 4, 5, ..., so the
+ * cost of servicing several can be seen. Build with -DLR_USE_DIGITALREAD ("make isr" does both) to compare with 
+ * sampling the receivers through digitalRead(). Then, with DECODE_STATS (which the Makefile defines), come the 
+ * library's statistics counters: what became of the frames, and how often each decoder was tried in vain.
+ *
+ * With -t, the library's latency histograms (see LATENCY_STATS in LRremote.h, which the Makefile defines) follow: how
+ * long each frame took from its first MARK to being captured, decoded and read. Without -l the frames are only read
+ * after the silence that follows them, so use -l too to see a realistic dispatch latency. The simulated clock only 
+ * moves when LRhost says so, not while the library's code runs, so decoding always takes no time here.
+ *
+ * With -m, each transmission in template-file is learned first (see learn()), one template each, and the receiver 
+ * then looks for them in the captures that follow. A transmission that matches the nth template (counting from 0) 
+ * decodes as LEARNED, with the value LEARNED_CODE(n).
+ *
+ * With -w, the receiver is an LRremoteBuf<LONG_RAWBUF, uint16_t> instead of an LRremote, with room for the long 
+ * frames of air conditioner remotes.
+ *
+ * With -x, each transmission is first sent through LRsender (see IR_SEND in LRremote.h, which the Makefile defines), 
+ * and what the simulated IR LED on TIMER_PWM_PIN gives out -- the carrier switched on and off by the timer ISR -- is 
+ * played to the receiver instead. The receiver moves to pin 2, out of the LED's way.
+ *
+ * With -a, NEC and Samsung frames are only taken from the remote at address, in hex (see setAddress()); those from
+ * other remotes, and any that fail the complement checks, are dropped (VALIDATE_FRAMES, which the Makefile defines).
+ *
+ * With -k, every MARK is played us microseconds longer and every SPACE that much shorter, as by a receiver module 
+ * that stretches MARKs more than most (or, for a negative us, less). With -c the receiver calibrates itself (see 
+ * CALIBRATE_EXCESS in LRremote.h, which the Makefile defines) and the histograms it measured, and the MARK excess it 
+ * settled on, follow the results. E.g. "LRreplay -c -k 80" for a module with an excess of 180us.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "LRhost.h"
+
+#define RECV_PIN 3
+#define SEND_RECV_PIN 2								// The receiver's pin for -x: pin 3 is the LED's
+#define SEND_KHZ 38									// Carrier for -x
+#define MAX_DURATIONS 1024
+#define LINE_GAP 100000UL							// Silence after each transmission (us)
+#define POLL_STEP 10UL								// How often -l polls decode() (us)
+#define LONG_RAWBUF 400								// Frame slot size for -w
+#define MAX_TEMPLATES 32							// Most transmissions -m can learn
+
+// Rough cost of what the ISRs do on an ATmega328P, in cycles, for the -s estimate. Like LRbench's, they're only 
+// estimates, good for comparing one build with another.
+#define ISR_CYCLES 60								// Entering and leaving an ISR that calls out: saving registers
+#define DIGITALREAD_CYCLES 60						// digitalRead(): pin table lookups in flash, PWM check, the read
+#define PORT_READ_CYCLES 6							// Reading a port input register through a pointer and masking
+#define SAMPLE_CYCLES 30							// One step of a receiver's state machine
+#define RECORD_CYCLES 25							// Storing a duration
+#define MATCH_CYCLES 16								// A duration range test (streaming decoders)
+
+static bool raw = false;
+static uint8_t recvPin = RECV_PIN;					// Where the receiver is
+static unsigned long lastEdge;						// micros() at the last transition played (-l)
+
+/*
+ * parseLine() -- Parse one line of a capture file into durations[]. Returns the count of them, 0 if there are none.
+ *
+ */
+static int parseLine(char *line, unsigned long durations[]) {
+	int count = 0;
+	for (char *tok = strtok(line, " \t\r\n,"); tok && count < MAX_DURATIONS; tok = strtok(NULL, " \t\r\n,")) {
+		if (*tok == '#') {
+			break;
+		}
+		durations[count++] = strtoul(tok, NULL, 10);
+	}
+	return count;
+}
+
+/*
+ * learnFile() -- Learn each transmission in file into templates[], printing what became of it. Returns the count of
+ * templates learned, or -1 if the file can't be read.
+ *
+ */
+static int learnFile(LRreceiver &remote, const char *file, LRtemplate templates[]) {
+	FILE *f = fopen(file, "r");
+	if (!f) {
+		perror(file);
+		return -1;
+	}
+	char line[8192];
+	static unsigned long durations[MAX_DURATIONS];
+	int learned = 0;
+	for (int lineNo = 1; fgets(line, sizeof(line), f) && learned < MAX_TEMPLATES; lineNo++) {
+		int count = parseLine(line, durations);
+		if (count == 0) {
+			continue;
+		}
+		remote.learn(&templates[learned]);
+		LRhost::play(recvPin, durations, count);
+		LRhost::space(recvPin, LINE_GAP);
+		if (remote.learning()) {
+			remote.learn(0);
+			printf("%s:%d not learned\n", file, lineNo);
+			continue;
+		}
+		const LRtemplate &tmpl = templates[learned];
+		printf("%s:%d learned as 0x%08lX: %d entries of", file, lineNo, LEARNED_CODE(learned), tmpl.length);
+		for (int i = 0; i < TEMPLATE_SYMBOLS && tmpl.ticks[i] != 0; i++) {
+			printf(" %d", tmpl.ticks[i]);
+		}
+		printf(" ticks\n");
+		learned++;
+	}
+	fclose(f);
+	return learned;
+}
+
+/*
+ * resend() -- Send count durations through LRsender and replace them with what came out of the LED. Returns the 
+ * count of those.
+ *
+ */
+static int resend(unsigned long durations[], int count) {
+	static unsigned int frame[MAX_DURATIONS];
+	for (int i = 0; i < count; i++) {
+		frame[i] = durations[i] < 65535 ? durations[i] : 65535;
+	}
+	if (!LRsender::send(frame, count, SEND_KHZ)) {
+		return 0;
+	}
+	while (LRsender::sending()) {
+		LRhost::advance(POLL_STEP);
+	}
+	return LRhost::emitted(durations, MAX_DURATIONS);
+}
+
+/*
+ * report() -- Print a decoded transmission from file:lineNo. latency < 0 means it wasn't measured.
+ *
+ */
+static void report(const char *file, int lineNo, const LRhostResult &result, long latency) {
+	if (raw) {
+		printf("%s", LRhost::protocolName(result.decode_type));
+		for (unsigned int i = 0; i < result.rawlen; i++) {
+			printf(" %u", result.raw[i]);
+		}
+		printf("\n");
+		return;
+	}
+	printf("%s:%d %s 0x%08lX %d", file, lineNo, LRhost::protocolName(result.decode_type), result.value, result.bits);
+	if (latency >= 0) {
+		printf(" +%ldus", latency);
+	}
+	printf("\n");
+}
+
+/*
+ * playPolled() -- Set the receiver's output to level for us microseconds, polling decode() every POLL_STEP and 
+ * reporting whatever it returns. Returns the number of transmissions reported.
+ *
+ */
+static int playPolled(LRreceiver &remote, int level, unsigned long us, const char *file, int lineNo) {
+	if (LRhost::getPin(recvPin) != level) {
+		LRhost::setPin(recvPin, level);
+		lastEdge = micros();
+	}
+	int count = 0;
+	LRhostResult result;
+	for (unsigned long t = 0; t < us; t += POLL_STEP) {
+		LRhost::advance(us - t < POLL_STEP ? us - t : POLL_STEP);
+		while (LRhost::decode(remote, result)) {
+			report(file, lineNo, result, micros() - lastEdge);
+			count++;
+		}
+	}
+	return count;
+}
+
+int main(int argc, char *argv[]) {
+	int mode = CAPTURE_POLL;
+	bool latency = false;
+	bool stats = false;
+	bool latencyTable = false;
+	int receivers = 1;
+	bool wide = false;
+	bool send = false;
+	bool calibrate = false;
+	long skew = 0;
+	long address = -1;
+	const char *templateFile = NULL;
+	int argi;
+	for (argi = 1; argi < argc && argv[argi][0] == '-'; argi++) {
+		if (strcmp(argv[argi], "-a") == 0 && argi + 1 < argc) {
+			address = strtol(argv[++argi], NULL, 16);
+		} else if (strcmp(argv[argi], "-c") == 0) {
+			calibrate = true;
+		} else if (strcmp(argv[argi], "-e") == 0) {
+			mode = CAPTURE_EDGE;
+		} else if (strcmp(argv[argi], "-k") == 0 && argi + 1 < argc) {
+			skew = atol(argv[++argi]);
+		} else if (strcmp(argv[argi], "-l") == 0) {
+			latency = true;
+		} else if (strcmp(argv[argi], "-r") == 0) {
+			raw = true;
+		} else if (strcmp(argv[argi], "-s") == 0) {
+			stats = true;
+		} else if (strcmp(argv[argi], "-t") == 0) {
+			latencyTable = true;
+		} else if (strcmp(argv[argi], "-n") == 0 && argi + 1 < argc) {
+			receivers = atoi(argv[++argi]);
+		} else if (strcmp(argv[argi], "-m") == 0 && argi + 1 < argc) {
+			templateFile = argv[++argi];
+		} else if (strcmp(argv[argi], "-w") == 0) {
+			wide = true;
+		} else if (strcmp(argv[argi], "-x") == 0) {
+			send = true;
+			recvPin = SEND_RECV_PIN;
+		} else {
+			break;
+		}
+	}
+	if (argi >= argc) {
+		fprintf(stderr, "Usage: %s [-a address] [-c] [-e] [-k us] [-l] [-r] [-s] [-t] [-m template-file] [-n receivers] [-w] [-x] "
+			"capture-file...\n", argv[0]);
+		return 2;
+	}
+
+	LRhost::reset();
+	LRremote normal(recvPin);
+	LRremoteBuf<LONG_RAWBUF, uint16_t> longFrames(recvPin);
+	LRreceiver &remote = wide ? (LRreceiver &)longFrames : normal;
+	remote.enable(mode);
+	remote.calibrate(calibrate);
+	remote.setAddress(address);
+	for (int i = 1; i < receivers && i < MAX_RECEIVERS; i++) {
+		(new LRremote(RECV_PIN + i))->enable(mode);
+	}
+	LRhost::space(recvPin, LINE_GAP);
+	static LRtemplate templates[MAX_TEMPLATES];
+	if (templateFile) {
+		int learned = learnFile(remote, templateFile, templates);
+		if (learned < 0) {
+			return 1;
+		}
+		remote.setTemplates(templates, learned);
+	}
+	memset(&lrIsrCounts, 0, sizeof(lrIsrCounts));
+
+	for (; argi < argc; argi++) {
+		FILE *f = fopen(argv[argi], "r");
+		if (!f) {
+			perror(argv[argi]);
+			return 1;
+		}
+		char line[8192];
+		static unsigned long durations[MAX_DURATIONS];
+		for (int lineNo = 1; fgets(line, sizeof(line), f); lineNo++) {
+			int count = parseLine(line, durations);
+			if (count == 0) {
+				continue;
+			}
+			if (send) {
+				count = resend(durations, count);
+			}
+			for (int i = 0; skew != 0 && i < count; i++) {
+				long us = i % 2 ? (long)durations[i] - skew : (long)durations[i] + skew;
+				durations[i] = us > 0 ? us : 1;
+			}
+			bool any = false;
+			if (latency) {
+				for (int i = 0; i < count; i++) {
+					any |= playPolled(remote, i % 2 ? HIGH : LOW, durations[i], argv[argi], lineNo) > 0;
+				}
+				any |= playPolled(remote, HIGH, LINE_GAP, argv[argi], lineNo) > 0;
+			} else {
+				LRhost::play(recvPin, durations, count);
+				LRhost::space(recvPin, LINE_GAP);
+				LRhostResult result;
+				while (LRhost::decode(remote, result)) {
+					any = true;
+					report(argv[argi], lineNo, result, -1);
+				}
+			}
+			if (!any && !raw) {
+				printf("%s:%d -\n", argv[argi], lineNo);
+			}
+		}
+		fclose(f);
+	}
+	if (stats) {
+		const LRcounts &n = lrIsrCounts;
+		unsigned long interrupts = n.ticks + n.edges;
+		unsigned long long cycles = (unsigned long long)ISR_CYCLES * interrupts + DIGITALREAD_CYCLES * n.pinReads + 
+			PORT_READ_CYCLES * n.portReads + SAMPLE_CYCLES * n.samples + RECORD_CYCLES * n.records + 
+			MATCH_CYCLES * n.matches;
+		printf("ISR: %lu timer, %lu edge interrupts; %lu samples, %lu digitalRead, %lu port reads, %lu records, "
+			"%lu matches\n", n.ticks, n.edges, n.samples, n.pinReads, n.portReads, n.records, n.matches);
+		printf("ISR: about %.1f cycles per interrupt (%.2f%% of the CPU)\n", interrupts ? (double)cycles / interrupts : 0.0,
+			100.0 * cycles / LRhost::cycles());
+#ifdef DECODE_STATS
+		LRstats counts;
+		LRreceiver::getStats(counts);
+		printf("Frames: %u captured, %u truncated, %u overruns, %u queue drops, %u noise, %u unrecognized, %u invalid\n",
+			counts.frames, counts.truncated, counts.overruns, counts.queueDrops, counts.noise, counts.unrecognized, 
+			counts.invalid);
+		for (int type = 0; type <= LEARNED; type++) {
+			if (counts.decoded[type] != 0 || counts.rejected[type] != 0) {
+				printf("  %-12s %5u decoded %5u rejected\n", LRhost::protocolName(type == 0 ? UNKNOWN : type), 
+					counts.decoded[type], counts.rejected[type]);
+			}
+		}
+#endif
+	}
+	if (calibrate) {
+		LRcalibration cal;
+		remote.getCalibration(cal);
+		printf("Calibration: MARK excess %dus (MARK_EXCESS %dus)\n", cal.excess, MARK_EXCESS);
+		printf("  excess(us)  marks spaces\n");
+		for (int i = 0; i < CALIBRATE_BUCKETS; i++) {
+			if (cal.marks[i] != 0 || cal.spaces[i] != 0) {
+				printf("  %4d..%-4d %6u %6u\n", CALIBRATE_MIN + i * CALIBRATE_STEP, 
+					CALIBRATE_MIN + (i + 1) * CALIBRATE_STEP - 1, cal.marks[i], cal.spaces[i]);
+			}
+		}
+	}
+	if (latencyTable) {
+#ifdef LATENCY_STATS
+		LRreceiver::printLatency(Serial);
+#else
+		printf("Latency: build with -DLATENCY_STATS\n");
+#endif
+	}
+	return 0;
+}
@@ -0,0 +1,764 @@
+/*
+ * LRtest.cpp -- Checks of the LRremote library's behavior on the host
+ *
+ * Usage: LRtest
+ *
+ * Plays NEC frames into receivers through the simulated hardware in LRhost, the way a remote would, and checks what
+ * the library does with them: which button functions it calls, how many times and when. Each check that fails is
+ * printed as
+ *
+ *   LRtest.cpp:LINE: what should have been true
+ *
+ * followed by a count of the checks and failures, and the exit status is 1 if any failed. "make test" runs it.
+ *
+ * The keymap checks give onButton() keymaps that sortKeys() has sorted -- listed out of order, with a code listed
+ * twice and with a function of its own for REPEAT -- and check that every code calls its own function, that one
+ * listed twice calls the first listed, and that a code that isn't there calls nothing. The binding table checks do
+ * the same for onButton_P(), and that each handler gets its entry's ctx. The queue checks send more frames than
+ * EVENT_QUEUE holds before calling read(), and check that read() and poll() hand over the ones that fit, in order, and
+ * that overruns() and getStats() count the rest. The receiver checks play frames into two LRremoteBufs at once, 
+ * overlapping by different amounts, and check that each decodes its own and nothing of the other's. The repeat 
+ * checks hold buttons down, with NEC repeat frames NEC_PERIOD apart, calling onButton() every STEP as a sketch's 
+ * loop() would, and check that the button functions are called when setRepeat() says, each within a tick and a STEP:
+ * at the press, after the delay, then at the rate, speeding up to the fastest, and never once the button's let go.
+ * The learning checks learn() two unknown frames and check that, once setTemplates() has the templates, or a copy of
+ * their bytes, each frame decodes as LEARNED with its own LEARNED_CODE(), and as UNKNOWN when it isn't in the table.
+ * The validation checks send NEC frames with a bad command complement, and, after setAddress(), from another remote,
+ * and check that they're counted as invalid in getStats() and reach neither onButton() nor read(), while good ones do.
+ *
+ * LRtest-hash64 is the same checks built with HASH_64, plus one that keymaps and binding tables tell UNKNOWN buttons
+ * apart by the whole 64-bit hash: an entry with the low 32 bits right and the high 32 wrong mustn't match.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "LRhost.h"
+#include "LRremoteInt.h"
+
+#define RECV_PIN 3
+#define PIN_A 4										// The two receivers of the receiver checks, on the same port
+#define PIN_B 5
+#define SILENCE 200000UL							// Between presses (us): longer than REPEAT_HOLD, so each is new
+#define STEP 1000UL									// How often the sketch calls onButton() (us)
+#define KEYS 8										// Button functions
+#define BIG_KEYMAP 100								// Keys in the big keymap
+#define FRAME_GAP 40000UL							// Between the frames sent to fill the queue (us)
+#define NEC_PERIOD 108000UL							// NEC frames start this far apart while a button's held (us)
+#define MAX_FRAMES 16								// Most frames of a repeat check
+#define MAX_ACTS 32									// Most calls of button functions a repeat check notes
+
+static int checks;
+static int failures;
+
+#define CHECK(what) check((what), #what, __LINE__)
+
+static void check(bool ok, const char *what, int line) {
+	checks++;
+	if (!ok) {
+		printf("LRtest.cpp:%d: %s\n", line, what);
+		failures++;
+	}
+}
+
+static LRremote remote(RECV_PIN);
+
+/*
+ * necCode() -- The NEC value for command from the remote at address: each byte followed by its complement.
+ *
+ */
+static unsigned long necCode(uint8_t address, uint8_t command) {
+	return (unsigned long)address << 24 | (unsigned long)(uint8_t)~address << 16 | (unsigned int)command << 8 |
+		(uint8_t)~command;
+}
+
+/*
+ * necFrame() -- Fill in durations[] with an NEC frame for code, or an NEC repeat frame for REPEAT. Returns the count.
+ *
+ */
+static int necFrame(unsigned long code, unsigned long durations[]) {
+	int count = 0;
+	durations[count++] = NEC_HDR_MARK;
+	if (code == REPEAT) {
+		durations[count++] = NEC_RPT_SPACE;
+	} else {
+		durations[count++] = NEC_HDR_SPACE;
+		for (int bit = NEC_BITS - 1; bit >= 0; bit--) {
+			durations[count++] = NEC_BIT_MARK;
+			durations[count++] = (code >> bit) & 1 ? NEC_ONE_SPACE : NEC_ZERO_SPACE;
+		}
+	}
+	durations[count++] = NEC_BIT_MARK;
+	return count;
+}
+
+/*
+ * sendNEC() -- Play an NEC frame for code, or an NEC repeat frame for REPEAT, into the receiver on pin.
+ *
+ */
+static void sendNEC(uint8_t pin, unsigned long code) {
+	unsigned long durations[2 * NEC_BITS + 3];
+	LRhost::play(pin, durations, necFrame(code, durations));
+}
+
+/*
+ * sendTogether() -- Play NEC frames into two receivers at once: codeA on pinA, and codeB on pinB starting offset us 
+ * later. Returns, in endA and endB, micros() when each frame's last MARK ended.
+ *
+ */
+static void sendTogether(uint8_t pinA, unsigned long codeA, uint8_t pinB, unsigned long codeB, unsigned long offset,
+		unsigned long &endA, unsigned long &endB) {
+	struct {
+		uint8_t pin;
+		unsigned long durations[2 * NEC_BITS + 3];
+		int count;
+		int next;									// The duration that starts at the next transition
+		unsigned long at;							// When that is
+	} frames[2];
+	frames[0].pin = pinA;
+	frames[0].count = necFrame(codeA, frames[0].durations);
+	frames[0].at = micros();
+	frames[1].pin = pinB;
+	frames[1].count = necFrame(codeB, frames[1].durations);
+	frames[1].at = frames[0].at + offset;
+	frames[0].next = frames[1].next = 0;
+	for (;;) {												// Each transition, in order of time
+		int f = frames[0].next > frames[0].count ? 1 :
+			frames[1].next > frames[1].count || frames[0].at <= frames[1].at ? 0 : 1;
+		if (frames[f].next > frames[f].count) {
+			break;
+		}
+		LRhost::advance(frames[f].at - micros());
+		if (frames[f].next == frames[f].count) {			// The end of its last MARK
+			LRhost::setPin(frames[f].pin, HIGH);
+			(f == 0 ? endA : endB) = frames[f].at;
+		} else {
+			LRhost::setPin(frames[f].pin, frames[f].next % 2 ? HIGH : LOW);
+			frames[f].at += frames[f].durations[frames[f].next];
+		}
+		frames[f].next++;
+	}
+}
+
+/*
+ * The button functions. Each counts its calls in calls[].
+ *
+ */
+static int calls[KEYS];
+
+static void key0() { calls[0]++; }
+static void key1() { calls[1]++; }
+static void key2() { calls[2]++; }
+static void key3() { calls[3]++; }
+static void key4() { calls[4]++; }
+static void key5() { calls[5]++; }
+static void key6() { calls[6]++; }
+static void key7() { calls[7]++; }
+
+static void (*const keyFunctions[KEYS])() = {key0, key1, key2, key3, key4, key5, key6, key7};
+
+/*
+ * keyOf() -- Which of the button functions fn is; KEYS if none.
+ *
+ */
+static int keyOf(void (*fn)()) {
+	int key = 0;
+	while (key < KEYS && keyFunctions[key] != fn) {
+		key++;
+	}
+	return key;
+}
+
+/*
+ * pressKey() -- Press the button for code once and let go, calling onButton(keymap) every STEP while it's sent and for
+ * SILENCE after. Returns the count of times onButton() acted, and leaves what it called in calls[].
+ *
+ */
+static int pressKey(const LRkey keymap[], int keyCount, unsigned long code) {
+	memset(calls, 0, sizeof(calls));
+	sendNEC(RECV_PIN, code);
+	int acted = 0;
+	for (unsigned long t = 0; t < SILENCE; t += STEP) {
+		acted += remote.onButton(keymap, keyCount);
+		LRhost::advance(STEP);
+	}
+	return acted;
+}
+
+/*
+ * onlyCalled() -- Whether key was called exactly once, and no other.
+ *
+ */
+static bool onlyCalled(int key) {
+	for (int i = 0; i < KEYS; i++) {
+		if (calls[i] != (i == key)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool nothingCalled() {
+	return onlyCalled(KEYS);
+}
+
+/*
+ * testKeymap() -- sortKeys() and onButton() with a keymap.
+ *
+ */
+static void testKeymap() {
+	const unsigned long power = necCode(0x10, 0xD8), up = necCode(0x10, 0x08), down = necCode(0x10, 0x88);
+	const unsigned long mute = necCode(0x00, 0x30), input = necCode(0x80, 0x40);
+	LRkey keymap[] = {											// Out of order, with mute twice
+		{power, key0}, {mute, key1}, {REPEAT, key2}, {up, key3}, {input, key4}, {mute, key5}, {down, key6},
+	};
+	const int keyCount = sizeof(keymap) / sizeof(keymap[0]);
+	LRkey listed[keyCount];
+	memcpy(listed, keymap, sizeof(keymap));
+
+	LRremote::sortKeys(keymap, keyCount);
+	for (int i = 1; i < keyCount; i++) {
+		CHECK(keymap[i - 1].code <= keymap[i].code);
+	}
+	for (int i = 0; i < keyCount; i++) {						// Every entry still there, with its own function
+		int found = 0;
+		for (int j = 0; j < keyCount; j++) {
+			found += keymap[j].code == listed[i].code && keymap[j].fButton == listed[i].fButton;
+		}
+		CHECK(found == 1);
+	}
+	for (int i = 1; i < keyCount; i++) {						// The two mutes in the order they were listed
+		if (keymap[i].code == mute) {
+			CHECK(keymap[i - 1].code != mute || (keymap[i - 1].fButton == key1 && keymap[i].fButton == key5));
+		}
+	}
+
+	CHECK(pressKey(keymap, keyCount, power) == 1 && onlyCalled(0));
+	CHECK(pressKey(keymap, keyCount, up) == 1 && onlyCalled(3));
+	CHECK(pressKey(keymap, keyCount, input) == 1 && onlyCalled(4));	// The last but one
+	CHECK(pressKey(keymap, keyCount, down) == 1 && onlyCalled(6));
+	CHECK(pressKey(keymap, keyCount, mute) == 1 && onlyCalled(1));	// Listed twice: the first one listed
+	CHECK(pressKey(keymap, keyCount, necCode(0x10, 0x18)) == 0 && nothingCalled());	// Not in the keymap
+	CHECK(pressKey(keymap, 0, power) == 0 && nothingCalled());		// An empty keymap
+
+	// A REPEAT with a function of its own calls that, not the repeat engine. It's the highest code, so it's last.
+	CHECK(keymap[keyCount - 1].code == REPEAT);
+	memset(calls, 0, sizeof(calls));
+	sendNEC(RECV_PIN, up);
+	int acted = 0;
+	for (int i = 0; i < 20; i++) {
+		acted += remote.onButton(keymap, keyCount);
+		LRhost::advance(STEP);
+	}
+	sendNEC(RECV_PIN, REPEAT);
+	for (unsigned long t = 0; t < SILENCE; t += STEP) {
+		acted += remote.onButton(keymap, keyCount);
+		LRhost::advance(STEP);
+	}
+	CHECK(acted == 2 && calls[3] == 1 && calls[2] == 1);
+}
+
+/*
+ * testBigKeymap() -- sortKeys() and onButton() with a keymap too big to search one entry at a time.
+ *
+ */
+static void testBigKeymap() {
+	static LRkey keymap[BIG_KEYMAP];
+	unsigned int seed = 12345;
+	for (int i = 0; i < BIG_KEYMAP; i++) {						// Distinct codes in no particular order
+		seed = seed * 1103515245 + 12345;
+		keymap[i].code = necCode((seed >> 16) & 0xFF, i);
+		keymap[i].fButton = keyFunctions[i % KEYS];
+	}
+	LRremote::sortKeys(keymap, BIG_KEYMAP);
+	for (int i = 1; i < BIG_KEYMAP; i++) {
+		CHECK(keymap[i - 1].code < keymap[i].code);
+	}
+	int wrong = 0;
+	for (int i = 0; i < BIG_KEYMAP; i++) {						// Every one of them calls its own function
+		int acted = pressKey(keymap, BIG_KEYMAP, keymap[i].code);
+		wrong += acted != 1 || !onlyCalled(keyOf(keymap[i].fButton));
+	}
+	CHECK(wrong == 0);
+}
+
+/*
+ * The binding table handler. Its ctx is the count of its calls for that entry.
+ *
+ */
+static void countCall(void *ctx) {
+	(*(int *)ctx)++;
+}
+
+static void otherCall(void *ctx) {
+	(*(int *)ctx) += 100;
+}
+
+static const unsigned long tvPower = 0x20DF10EF, tvUp = 0x20DF40BF, tvDown = 0x20DFC03F, tvMute = 0x20DF906F;
+
+static const LRbinding bindings[] PROGMEM = {						// In order of code
+	{tvPower, countCall, &calls[0]},
+	{tvUp, countCall, &calls[1]},
+	{tvMute, countCall, &calls[2]},
+	{tvMute, otherCall, &calls[3]},									// Listed twice
+	{tvDown, countCall, &calls[4]},
+	{REPEAT, otherCall, &calls[5]},
+};
+
+/*
+ * pressBinding() -- pressKey() for onButton_P(bindings).
+ *
+ */
+static int pressBinding(int bindingCount, unsigned long code) {
+	memset(calls, 0, sizeof(calls));
+	sendNEC(RECV_PIN, code);
+	int acted = 0;
+	for (unsigned long t = 0; t < SILENCE; t += STEP) {
+		acted += remote.onButton_P(bindings, bindingCount);
+		LRhost::advance(STEP);
+	}
+	return acted;
+}
+
+/*
+ * testBindings() -- onButton_P() with a binding table.
+ *
+ */
+static void testBindings() {
+	const int bindingCount = sizeof(bindings) / sizeof(bindings[0]);
+	CHECK(pressBinding(bindingCount, tvPower) == 1 && onlyCalled(0));
+	CHECK(pressBinding(bindingCount, tvDown) == 1 && onlyCalled(4));
+	CHECK(pressBinding(bindingCount, tvUp) == 1 && onlyCalled(1));
+	CHECK(pressBinding(bindingCount, tvMute) == 1 && onlyCalled(2));	// Listed twice: the first one listed
+	CHECK(pressBinding(bindingCount, necCode(0x20, 0x00)) == 0 && nothingCalled());
+	CHECK(pressBinding(bindingCount - 1, tvDown) == 1 && onlyCalled(4));	// The last entry of an odd count
+	CHECK(pressBinding(0, tvPower) == 0 && nothingCalled());
+
+	memset(calls, 0, sizeof(calls));							// A REPEAT with a handler of its own
+	sendNEC(RECV_PIN, tvUp);
+	int acted = 0;
+	for (int i = 0; i < 20; i++) {
+		acted += remote.onButton_P(bindings, bindingCount);
+		LRhost::advance(STEP);
+	}
+	sendNEC(RECV_PIN, REPEAT);
+	for (unsigned long t = 0; t < SILENCE; t += STEP) {
+		acted += remote.onButton_P(bindings, bindingCount);
+		LRhost::advance(STEP);
+	}
+	CHECK(acted == 2 && calls[1] == 1 && calls[5] == 100);
+}
+
+/*
+ * testQueue() -- read() and poll() with more frames waiting than the event queue holds.
+ *
+ */
+static void testQueue() {
+	const int sent = EVENT_QUEUE + 2;
+	unsigned long sentAt[sent];
+	unsigned int overruns = remote.overruns();
+	LRstats stats;
+	LRremote::getStats(stats, true);
+
+	for (int i = 0; i < sent; i++) {							// Nobody reading meanwhile
+		sendNEC(RECV_PIN, necCode(0x10, i));
+		sentAt[i] = micros();
+		LRhost::space(RECV_PIN, FRAME_GAP);
+	}
+	CHECK(remote.overruns() - overruns == sent - EVENT_QUEUE);
+	LRremote::getStats(stats);
+	CHECK(stats.frames == sent);
+	CHECK(stats.decoded[NEC] == sent);
+	CHECK(stats.queueDrops == sent - EVENT_QUEUE);
+	CHECK(stats.overruns == 0);
+
+	LRevent event;
+	for (int i = 0; i < EVENT_QUEUE - 1; i++) {					// The first ones sent, oldest first
+		CHECK(remote.read(event));
+		CHECK(event.decode_type == NEC && event.bits == NEC_BITS && event.value == necCode(0x10, i));
+		CHECK(event.time - sentAt[i] <= USECPERTICK);			//   Timed from the tick that saw it end
+	}
+	DecodeResult result;
+	CHECK(remote.poll(result));
+	CHECK(result.decode_type == NEC && result.value == necCode(0x10, EVENT_QUEUE - 1));
+	CHECK(!remote.read(event));
+	CHECK(!remote.poll(result));
+
+	sendNEC(RECV_PIN, necCode(0x10, 0x55));						// And there's room again
+	LRhost::space(RECV_PIN, FRAME_GAP);
+	CHECK(remote.read(event) && event.value == necCode(0x10, 0x55));
+	CHECK(remote.overruns() - overruns == sent - EVENT_QUEUE);
+	LRhost::space(RECV_PIN, SILENCE);
+}
+
+/*
+ * testReceivers() -- Two LRremoteBufs, of different sizes, receiving at the same time.
+ *
+ */
+static LRremoteBuf<RAWBUF> remoteA(PIN_A);
+static LRremoteBuf<200, uint16_t> remoteB(PIN_B);
+
+static void testReceivers() {
+	static const unsigned long offsets[] = {0, 5, 560, 4500, 20000, 60000, 67000};	// B starts this much after A
+	unsigned int overrunsA = remoteA.overruns(), overrunsB = remoteB.overruns();
+	LRevent event;
+	for (unsigned int i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++) {
+		unsigned long codeA = necCode(0x40, i), codeB = necCode(0x41, 0x80 + i), endA, endB;
+		sendTogether(PIN_A, codeA, PIN_B, codeB, offsets[i], endA, endB);
+		LRhost::advance(FRAME_GAP);
+		CHECK(remoteA.read(event) && event.decode_type == NEC && event.value == codeA);
+		CHECK(event.time - endA <= USECPERTICK);
+		CHECK(!remoteA.read(event));
+		CHECK(remoteB.read(event) && event.decode_type == NEC && event.value == codeB);
+		CHECK(event.time - endB <= USECPERTICK);
+		CHECK(!remoteB.read(event));
+		CHECK(!remote.read(event));								// The receiver on RECV_PIN saw nothing
+	}
+
+	unsigned long endA, endB;									// A repeat on one while the other sends a frame
+	sendTogether(PIN_A, necCode(0x40, 0x10), PIN_B, necCode(0x41, 0x10), 0, endA, endB);
+	LRhost::advance(FRAME_GAP);
+	sendTogether(PIN_A, REPEAT, PIN_B, necCode(0x41, 0x11), 1000, endA, endB);
+	LRhost::advance(FRAME_GAP);
+	CHECK(remoteA.read(event) && event.value == necCode(0x40, 0x10));
+	CHECK(remoteA.read(event) && event.decode_type == NEC && event.value == REPEAT && event.bits == 0);
+	CHECK(!remoteA.read(event));
+	CHECK(remoteB.read(event) && event.value == necCode(0x41, 0x10));
+	CHECK(remoteB.read(event) && event.value == necCode(0x41, 0x11));
+	CHECK(!remoteB.read(event));
+	CHECK(remoteA.overruns() == overrunsA && remoteB.overruns() == overrunsB);
+	LRhost::advance(SILENCE);
+}
+
+/*
+ * The repeat checks' sketch: a keymap, onButton() called every STEP, and when it acted.
+ *
+ */
+static const LRkey *pollKeymap;
+static int pollKeyCount;
+static unsigned long nextPoll;								// micros() when the sketch next calls onButton()
+static unsigned long acts[MAX_ACTS];						// micros() each time it acted
+static int actCount;
+
+/*
+ * waitPolling() -- Let us pass, calling onButton(pollKeymap) every STEP meanwhile and noting in acts[] when it acted.
+ *
+ */
+static void waitPolling(unsigned long us) {
+	unsigned long end = micros() + us;
+	while ((long)(end - nextPoll) >= 0) {
+		LRhost::advance(nextPoll - micros());
+		if (remote.onButton(pollKeymap, pollKeyCount) && actCount < MAX_ACTS) {
+			acts[actCount++] = micros();
+		}
+		nextPoll += STEP;
+	}
+	LRhost::advance(end - micros());
+}
+
+/*
+ * sendFrames() -- Send the NEC frames codes[], NEC_PERIOD apart (0 for none in that slot), calling onButton(keymap) 
+ * every STEP while they're sent and for SILENCE after. Fills in ends[] with micros() when each frame's last MARK 
+ * ended, and leaves in acts[] and calls[] when onButton() acted and what it called.
+ *
+ */
+static void sendFrames(const LRkey keymap[], int keyCount, const unsigned long codes[], int frameCount, 
+		unsigned long ends[]) {
+	pollKeymap = keymap;
+	pollKeyCount = keyCount;
+	actCount = 0;
+	memset(calls, 0, sizeof(calls));
+	unsigned long start = nextPoll = micros();
+	for (int f = 0; f < frameCount; f++) {
+		waitPolling(start + f * NEC_PERIOD - micros());
+		if (codes[f] == 0) {
+			continue;
+		}
+		unsigned long durations[2 * NEC_BITS + 3];
+		int count = necFrame(codes[f], durations);
+		for (int i = 0; i < count; i++) {
+			LRhost::setPin(RECV_PIN, i % 2 ? HIGH : LOW);
+			waitPolling(durations[i]);
+		}
+		LRhost::setPin(RECV_PIN, HIGH);
+		ends[f] = micros();
+	}
+	waitPolling(SILENCE);
+}
+
+/*
+ * actedAt() -- Whether onButton() acted at due[] and only then: on its first call at or after each (the frames' 
+ * timestamps can be up to a tick after their ends).
+ *
+ */
+static bool actedAt(const unsigned long due[], int dueCount) {
+	if (actCount != dueCount) {
+		return false;
+	}
+	for (int i = 0; i < dueCount; i++) {
+		if (acts[i] - due[i] > USECPERTICK + STEP) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * testRepeat() -- keyAction(): holding buttons down, with the repeat settings setRepeat() gives it.
+ *
+ */
+static void testRepeat() {
+	const unsigned long R = REPEAT, X = necCode(0x10, 0x01), Y = necCode(0x10, 0x02);
+	LRkey keymap[] = {{X, key0}, {Y, key1}};
+	LRremote::sortKeys(keymap, 2);
+	unsigned long ends[MAX_FRAMES];
+
+	// A press and let go: called once, at the press
+	static const unsigned long tap[] = {X};
+	remote.setRepeat(500, 200, 200, 0);
+	sendFrames(keymap, 2, tap, 1, ends);
+	unsigned long tapDue[] = {ends[0]};
+	CHECK(actedAt(tapDue, 1) && calls[0] == 1);
+
+	// Held for nine repeats, the last ending at about 916ms after the press, held until about 1051ms. At a steady 
+	// rate: at the press, then 500ms later, then every 200ms.
+	static const unsigned long held[] = {X, R, R, R, R, R, R, R, R, R};
+	const int heldCount = sizeof(held) / sizeof(held[0]);
+	sendFrames(keymap, 2, held, heldCount, ends);
+	unsigned long steadyDue[] = {ends[0], ends[0] + 500000, ends[0] + 700000, ends[0] + 900000};
+	CHECK(actedAt(steadyDue, 4) && calls[0] == 4 && calls[1] == 0);
+
+	// Speeding up by 64/256 each time, from 200ms to no faster than 100ms: 200, 150, 112.5, then 100ms apart
+	remote.setRepeat(300, 200, 100, 64);
+	sendFrames(keymap, 2, held, heldCount, ends);
+	unsigned long fasterDue[] = {ends[0], ends[0] + 300000, ends[0] + 500000, ends[0] + 650000, ends[0] + 762500,
+		ends[0] + 862500, ends[0] + 962500};
+	CHECK(actedAt(fasterDue, 7) && calls[0] == 7);
+
+	// The defaults: REPEAT_DELAY, REPEAT_RATE, REPEAT_FASTEST and REPEAT_ACCEL
+	remote.setRepeat(REPEAT_DELAY, REPEAT_RATE);
+	sendFrames(keymap, 2, held, heldCount, ends);
+	unsigned long defaultDue[] = {ends[0], ends[0] + 500000, ends[0] + 700000, ends[0] + 875000, ends[0] + 1028125};
+	CHECK(actedAt(defaultDue, 5) && calls[0] == 5);
+
+	// Another button while one's held: it acts at once and starts its own delay
+	remote.setRepeat(500, 200, 200, 0);
+	static const unsigned long other[] = {X, R, R, R, Y, R, R, R, R, R};
+	sendFrames(keymap, 2, other, sizeof(other) / sizeof(other[0]), ends);
+	unsigned long otherDue[] = {ends[0], ends[4], ends[4] + 500000};
+	CHECK(actedAt(otherDue, 3) && calls[0] == 1 && calls[1] == 2);
+
+	// Let go before the delay is up, then a repeat long after the last frame: that's a repeat of nothing
+	static const unsigned long gap[] = {X, R, R, 0, 0, 0, R, R};
+	sendFrames(keymap, 2, gap, sizeof(gap) / sizeof(gap[0]), ends);
+	unsigned long gapDue[] = {ends[0]};
+	CHECK(actedAt(gapDue, 1) && calls[0] == 1);
+
+	// The same button again after more than REPEAT_HOLD is a new press
+	static const unsigned long again[] = {X, 0, X};
+	sendFrames(keymap, 2, again, sizeof(again) / sizeof(again[0]), ends);
+	unsigned long againDue[] = {ends[0], ends[2]};
+	CHECK(actedAt(againDue, 2) && calls[0] == 2);
+	remote.setRepeat(REPEAT_DELAY, REPEAT_RATE);
+}
+
+/*
+ * sendUnknown(), sendOtherUnknown() -- Play a frame none of the decoders knows into the receiver: two different ones,
+ * the same length and made of the same durations.
+ *
+ */
+static void sendUnknown() {
+	static const unsigned long durations[] = {
+		3000, 3000, 500, 1500, 500, 500, 1500, 500, 500, 1500, 1500, 1500, 500, 500, 500, 1500, 1500, 500, 500, 1500, 
+		500, 500, 500,
+	};
+	LRhost::play(RECV_PIN, durations, sizeof(durations) / sizeof(durations[0]));
+}
+
+static void sendOtherUnknown() {
+	static const unsigned long durations[] = {
+		3000, 3000, 500, 500, 1500, 1500, 500, 500, 1500, 500, 500, 1500, 1500, 500, 500, 1500, 500, 1500, 500, 500, 
+		1500, 500, 500,
+	};
+	LRhost::play(RECV_PIN, durations, sizeof(durations) / sizeof(durations[0]));
+}
+
+/*
+ * readAfter() -- Let the frame just sent end, and read() what it decoded to into event. Returns what read() does.
+ *
+ */
+static bool readAfter(LRevent &event) {
+	LRhost::space(RECV_PIN, SILENCE);
+	return remote.read(event);
+}
+
+#if LR_DECODES(LEARNED)
+/*
+ * testLearn() -- learn() an unknown frame and look for it with setTemplates().
+ *
+ */
+static void testLearn() {
+	LRtemplate learned[2];
+	LRevent event;
+	memset(learned, 0xFF, sizeof(learned));					// As erased EEPROM reads
+
+	remote.learn(&learned[0]);
+	CHECK(remote.learning());
+	sendUnknown();
+	CHECK(!readAfter(event));								// Learned, not decoded
+	CHECK(!remote.learning());
+	CHECK(learned[0].length == 23);
+	remote.learn(&learned[1]);
+	sendOtherUnknown();
+	CHECK(!readAfter(event));
+	CHECK(!remote.learning() && learned[1].length == 23);
+	CHECK(memcmp(&learned[0], &learned[1], sizeof(learned[0])) != 0);
+
+	remote.setTemplates(learned, 1);
+	sendUnknown();
+	CHECK(readAfter(event) && event.decode_type == LEARNED && event.value == LEARNED_CODE(0) && event.bits == 32);
+	sendOtherUnknown();										// Not the one learned: hashed as always
+	CHECK(readAfter(event) && event.decode_type == UNKNOWN);
+	unsigned long otherHash = event.value;
+
+	LRtemplate saved[2];									// Out to EEPROM and back, say: the bytes are all there is
+	memcpy(saved, learned, sizeof(saved));
+	memset(learned, 0xFF, sizeof(learned));
+	remote.setTemplates(saved, 2);
+	sendUnknown();
+	CHECK(readAfter(event) && event.decode_type == LEARNED && event.value == LEARNED_CODE(0));
+	sendOtherUnknown();
+	CHECK(readAfter(event) && event.decode_type == LEARNED && event.value == LEARNED_CODE(1));
+
+	remote.setTemplates(0, 0);								// And none again
+	sendOtherUnknown();
+	CHECK(readAfter(event) && event.decode_type == UNKNOWN && event.value == otherHash);
+}
+#endif
+
+#ifdef VALIDATE_FRAMES
+/*
+ * testValidate() -- NEC frames with a bad command complement, or from a remote setAddress() doesn't take.
+ *
+ */
+static void testValidate() {
+	const unsigned long good = necCode(0x10, 0x08), other = necCode(0x20, 0x08);
+	const unsigned long badCommand = good ^ 0x01;				// The command's complement off by a bit
+	LRkey keymap[] = {{good, key0}, {badCommand, key1}, {other, key2}};
+	LRremote::sortKeys(keymap, 3);
+	LRstats stats;
+	LRevent event;
+
+	LRremote::getStats(stats, true);
+	CHECK(pressKey(keymap, 3, badCommand) == 0 && nothingCalled());
+	sendNEC(RECV_PIN, badCommand);
+	LRhost::space(RECV_PIN, SILENCE);
+	CHECK(!remote.read(event));
+	LRremote::getStats(stats);
+	CHECK(stats.invalid == 2 && stats.decoded[NEC] == 0);
+
+	CHECK(pressKey(keymap, 3, good) == 1 && onlyCalled(0));	// A good one still gets through
+
+	remote.setAddress(0x20DF);									// Only the remote at address 0x20
+	LRremote::getStats(stats, true);
+	CHECK(pressKey(keymap, 3, good) == 0 && nothingCalled());
+	sendNEC(RECV_PIN, good);
+	LRhost::space(RECV_PIN, SILENCE);
+	CHECK(!remote.read(event));
+	LRremote::getStats(stats);
+	CHECK(stats.invalid == 2 && stats.decoded[NEC] == 0);
+	CHECK(pressKey(keymap, 3, other) == 1 && onlyCalled(2));
+	sendNEC(RECV_PIN, other);
+	LRhost::space(RECV_PIN, SILENCE);
+	CHECK(remote.read(event) && event.decode_type == NEC && event.value == other);
+	remote.setAddress(-1);
+}
+#endif
+
+#ifdef HASH_64
+static int fullCalls, lowCalls, highCalls;
+
+static void countFull(void *ctx) { fullCalls++; }
+static void countLow(void *ctx) { lowCalls++; }
+static void countHigh(void *ctx) { highCalls++; }
+
+static const unsigned long unknownLow = 0x381D3417, unknownHigh = 0x2DEBF65D;	// sendUnknown()'s 64-bit hash
+
+static const LRbinding unknownBindings[] PROGMEM = {				// In order of code
+	{unknownLow, countLow, 0, 0},									// Only the low 32 bits
+	{unknownLow, countHigh, 0, unknownHigh ^ 1},					// The low 32 right and the high 32 wrong
+	{unknownLow, countFull, 0, unknownHigh},						// All 64
+};
+
+/*
+ * testHash64() -- Keymaps and binding tables with UNKNOWN buttons' 64-bit codes.
+ *
+ */
+static void testHash64() {
+	LRevent event;
+	sendUnknown();
+	LRhost::space(RECV_PIN, SILENCE);
+	CHECK(remote.read(event) && event.decode_type == UNKNOWN);
+	CHECK((uint32_t)event.value == unknownLow && event.hashHigh == unknownHigh);	// As unknownBindings[] has it
+	LRcode full = (LRcode)event.hashHigh << 32 | (uint32_t)event.value;
+	LRcode low = (uint32_t)event.value;
+	LRcode high = full ^ (LRcode)1 << 32;					// Right low 32 bits, wrong high 32
+
+	LRkey keymap[] = {{full, key0}, {low, key1}, {high, key2}};
+	LRremote::sortKeys(keymap, 3);
+	memset(calls, 0, sizeof(calls));
+	sendUnknown();
+	int acted = 0;
+	for (unsigned long t = 0; t < SILENCE; t += STEP) {
+		acted += remote.onButton(keymap, 3);
+		LRhost::advance(STEP);
+	}
+	CHECK(acted == 1 && onlyCalled(0));
+
+	LRkey partial[] = {{low, key1}, {high, key2}};				// Only the low 32 bits: nothing
+	LRremote::sortKeys(partial, 2);
+	memset(calls, 0, sizeof(calls));
+	sendUnknown();
+	acted = 0;
+	for (unsigned long t = 0; t < SILENCE; t += STEP) {
+		acted += remote.onButton(partial, 2);
+		LRhost::advance(STEP);
+	}
+	CHECK(acted == 0 && nothingCalled());
+
+	sendUnknown();
+	acted = 0;
+	for (unsigned long t = 0; t < SILENCE; t += STEP) {
+		acted += remote.onButton_P(unknownBindings, 3);
+		LRhost::advance(STEP);
+	}
+	CHECK(acted == 1 && fullCalls == 1 && lowCalls == 0 && highCalls == 0);
+}
+#endif
+
+int main() {
+	LRhost::reset();
+	remote.enable(CAPTURE_POLL);
+	remoteA.enable(CAPTURE_POLL);
+	remoteB.enable(CAPTURE_POLL);
+	LRhost::space(RECV_PIN, SILENCE);
+
+	testKeymap();
+	testBigKeymap();
+	testBindings();
+	testQueue();
+	testReceivers();
+	testRepeat();
+#if LR_DECODES(LEARNED)
+	testLearn();
+#endif
+#ifdef VALIDATE_FRAMES
+	testValidate();
+#endif
+#ifdef HASH_64
+	testHash64();
+#endif
+
+	printf("%d checks, %d failed\n", checks, failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+/*
+ * avr/interrupt.h -- Host (Linux) stand-in for the AVR interrupt header
+ *
+ * An ISR becomes an ordinary extern "C" function that LRhost calls when the simulated timer says so. cli() and sei()
+ * just track whether interrupts are enabled; LRhost won't run an ISR while they're off.
+ *
+ */
+
+#ifndef avr_interrupt_h
+#define avr_interrupt_h
+
+#define ISR(vector) extern "C" void vector(void)
+
+#define cli() noInterrupts()
+#define sei() interrupts()
+
+#endif
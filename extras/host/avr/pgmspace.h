@@ -0,0 +1,37 @@
+/*
+ * avr/pgmspace.h -- Host (Linux) stand-in for the AVR program memory header
+ *
+ * On the host, flash and RAM are one address space, so PROGMEM is nothing and the pgm_read_*() functions are just
+ * reads. The host Arduino.h includes this, as the real one does.
+ *
+ */
+
+#ifndef avr_pgmspace_h
+#define avr_pgmspace_h
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+
+static inline uint8_t pgm_read_byte(const void *addr) {
+	uint8_t b;
+	memcpy(&b, addr, sizeof(b));
+	return b;
+}
+
+static inline uint16_t pgm_read_word(const void *addr) {
+	uint16_t w;
+	memcpy(&w, addr, sizeof(w));
+	return w;
+}
+
+static inline uint32_t pgm_read_dword(const void *addr) {
+	uint32_t d;
+	memcpy(&d, addr, sizeof(d));
+	return d;
+}
+
+#define memcpy_P(dest, src, n) memcpy((dest), (src), (n))
+
+#endif
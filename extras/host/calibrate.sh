@@ -0,0 +1,44 @@
+#!/bin/sh
+#
+# calibrate.sh -- Check that a polled and an edge-captured receiver settle on the same MARK excess
+#
+# Usage: calibrate.sh [skews...]
+#
+# Each argument is a skew (us) for LRreplay -k: how much longer than usual the simulated module makes each MARK, and
+# shorter each SPACE. With no arguments, a standard set is checked. For each, the sample captures are replayed with
+# calibrate() on, polled and edge captured, and the two figures they settle on must be within a tick (USECPERTICK,
+# 50us) of each other. The polled ISR corrects in whole ticks and the edge ISR to the microsecond, so that's as close
+# as they can be, but they're measuring the same module and shouldn't be further apart.
+#
+
+REPLAY=${REPLAY:-./LRreplay}
+CAPTURES=${CAPTURES:-captures/*.txt}
+TICK=50
+
+if [ $# -eq 0 ]; then
+	set -- -40 0 80 150
+fi
+
+# excess [LRreplay options] -- The MARK excess the receiver settles on
+excess() {
+	$REPLAY -c "$@" $CAPTURES | sed -n 's/^Calibration: MARK excess \(-*[0-9]*\)us.*/\1/p'
+}
+
+status=0
+printf "%6s %8s %8s\n" "skew" "polled" "edge"
+for skew in "$@"; do
+	polled=$(excess -k "$skew")
+	edge=$(excess -e -k "$skew")
+	if [ -z "$polled" ] || [ -z "$edge" ]; then
+		echo "$skew: no calibration" >&2
+		exit 1
+	fi
+	printf "%6d %8d %8d" "$skew" "$polled" "$edge"
+	difference=$((polled - edge))
+	if [ ${difference#-} -gt $TICK ]; then
+		printf "  MISMATCH"
+		status=1
+	fi
+	printf "\n"
+done
+exit $status
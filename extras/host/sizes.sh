@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# sizes.sh -- Report the flash and RAM the LRremote library takes for a range of LR_PROTOCOLS choices
+#
+# Usage: sizes.sh [protocols...]
+#
+# Each argument is one choice: protocol names separated by commas, e.g. NEC,SAMSUNG. UNKNOWN is the hash of anything
+# else. With no arguments, a standard set of choices is reported. The library is compiled on its own with -Os for each
+# choice and measured with size; the RAM for each LRremote object the sketch has (its buffers are in there) is
+# reported separately, measured with nm. By default that's the host compiler and the stand-in headers in this directory, so
+# the numbers are only good for comparing one choice with another. To get real ones, point CXX, CPPFLAGS and SIZE at
+# an AVR toolchain and the Arduino core, e.g.
+#
+#   CXX="avr-g++ -mmcu=atmega328p" SIZE=avr-size NM=avr-nm CPPFLAGS="-DF_CPU=16000000L -DARDUINO=10800 -I<core> -I<variant>" \
+#     ./sizes.sh
+#
+
+CXX=${CXX:-c++}
+SIZE=${SIZE:-size}
+NM=${NM:-nm}
+CPPFLAGS=${CPPFLAGS:-"-DARDUINO=10800 -I."}
+LIBDIR=$(dirname "$0")/../..
+OBJ=${TMPDIR:-/tmp}/lrsizes$$.o
+SRC=${TMPDIR:-/tmp}/lrsizes$$.cpp
+trap 'rm -f "$OBJ" "$SRC"' EXIT
+echo '#include "LRremote.h"
+char lrObject[sizeof(LRremote)];' > "$SRC"
+
+if [ $# -eq 0 ]; then
+	set -- ALL NEC NEC,SAMSUNG NEC,UNKNOWN SONY,SANYO RC5,RC6 PANASONIC LG,JVC UNKNOWN
+fi
+
+printf "%-28s %8s %8s %10s\n" "protocols" "flash" "ram" "ram/object"
+for choice in "$@"; do
+	if [ "$choice" = ALL ]; then
+		define=""
+	else
+		define="-DLR_PROTOCOLS=($(echo "$choice" | sed 's/\([A-Z0-9]*\)/PROTOCOL_BIT(\1)/g; s/,/|/g'))"
+	fi
+	$CXX $CPPFLAGS -I"$LIBDIR" -Os -std=gnu++11 $define -c -o "$OBJ" "$LIBDIR/LRremote.cpp" || exit 1
+	# Berkeley format: text data bss dec hex filename. Flash is text + data, RAM is data + bss.
+	sizes=$($SIZE "$OBJ" | awk 'NR == 2 { print $1 + $2, $2 + $3 }')
+	$CXX $CPPFLAGS -I"$LIBDIR" -std=gnu++11 $define -c -o "$OBJ" "$SRC" || exit 1
+	object=$($NM -S -t d "$OBJ" | awk '$4 == "lrObject" { print $2 + 0 }')
+	printf "%-28s %8d %8d %10d\n" "$choice" $sizes "$object"
+done